@@ -0,0 +1,482 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include "defs.h"
+#include "symbol_table.h"
+#include "instructions.h"
+#include "source.h"
+#include "program.h"
+#include "analysis.h"
+
+#define FLAGS_SLOT 32 // NZCV, tracked like a register after x0-x30 (x31 is the zero register)
+#define NUM_SLOTS 33
+#define MAX_EFFECTS 4 // registers (or flags) one instruction reads, and writes
+#define WRITEBACK_LATENCY 1 // of the base register of a pre- or post-indexed transfer
+#define LOOP_PASSES 16 // iterations of a loop simulated to reach its steady state
+#define MAX_CHAIN_SHOWN 8 // links of a dependency chain printed before it is abbreviated
+#define NO_STEP UINT32_MAX
+
+// Cycles before an instruction's result can be used, and cycles it takes to issue.
+typedef struct {
+    uint32_t latency;
+    uint32_t issue;
+} cost;
+
+// Registers an instruction reads and writes, as slots (FLAGS_SLOT for the flags).
+typedef struct {
+    uint8_t reads[MAX_EFFECTS];
+    uint8_t numReads;
+    uint8_t writes[MAX_EFFECTS];
+    uint32_t writeLatency[MAX_EFFECTS];
+    uint8_t numWrites;
+    uint32_t latency; // until the last result is ready
+    uint32_t issue;
+} effects;
+
+// One instruction executed by simulate: when its result is ready, and the step it waited for.
+typedef struct {
+    uint32_t index;  // in the program
+    uint32_t pass;   // iteration of the run it belongs to
+    uint32_t finish;
+    uint32_t waitedFor; // step whose result it started on, or NO_STEP
+    uint8_t via;        // slot that result came through
+} step;
+
+// Straight-line run of instructions: control enters at first and leaves after last.
+typedef struct {
+    uint32_t first;
+    uint32_t last;
+} block;
+
+#define ISA_NAME(mnemonic, name, ...) [OP_##name] = mnemonic,
+static const char* mnemonics[NUM_OPCODES] = {
+    ISA_INSTRUCTIONS(ISA_NAME)
+    [OP_constant] = "mov",
+    [OP_data] = "data",
+};
+#undef ISA_NAME
+
+/*
+Cost model
+*/
+
+// Loads wait on memory and multiplies take several cycles; everything else has its result next cycle.
+static void defaultCosts(cost* costs) {
+    for (int op = 0; op < NUM_OPCODES; op++) {
+        costs[op].latency = 1;
+        costs[op].issue = 1;
+    }
+    costs[OP_madd].latency = costs[OP_msub].latency = 3;
+    costs[OP_ldr].latency = costs[OP_ldrb].latency = costs[OP_ldrh].latency = costs[OP_ldp].latency = 4;
+    costs[OP_ldp].issue = costs[OP_stp].issue = 2;
+    costs[OP_nop].latency = 0;
+    costs[OP_data].latency = costs[OP_data].issue = 0;
+    costs[OP_intdir].latency = costs[OP_intdir].issue = 0;
+}
+
+// Overrides costs with the lines of the file at path: "<mnemonic> <latency> [<issue cycles>]".
+// An alias sets the cost of the mnemonic it stands for (cmp sets subs).
+static void readCosts(char* path, cost* costs) {
+    source* src = openSource(path);
+    line_scan scan;
+    while (scanLine(src, &scan)) {
+        if (isBlankScan(&scan)) {
+            continue;
+        }
+        copyScanned(src, &scan);
+        char name[16];
+        unsigned latency;
+        unsigned issue = 1;
+        int fields = sscanf(src->line, "%15s %u %u", name, &latency, &issue);
+        const mnemonic_entry* entry = fields >= 2 ? lookupMnemonic(name) : NULL;
+        if (entry == NULL || issue == 0) {
+            fprintf(stderr, "assemble: %s: line %u is not \"<mnemonic> <latency> [<issue cycles>]\".\n",
+                    path, src->lineNumber);
+            exit(EXIT_FAILURE);
+        }
+        costs[entry->opcode].latency = latency;
+        costs[entry->opcode].issue = issue;
+    }
+    closeSource(src);
+}
+
+/*
+Dependencies
+*/
+
+static bool isConditionalBranch(instruction* ins) {
+    // Conditional branches are listed together in the ISA tables.
+    return ins->opcode >= OP_beq && ins->opcode <= OP_bnv;
+}
+
+// Returns whether ins is the halt instruction, and x0, x0, x0.
+static bool isHalt(instruction* ins) {
+    operand* ops = ins->operands;
+    return ins->opcode == OP_and && ins->numOperands == 3 && ops[0].is64
+        && ops[0].reg == 0 && ops[1].reg == 0 && ops[2].kind == OPERAND_REGISTER && ops[2].reg == 0;
+}
+
+// Returns whether ins is data placed among the code rather than an instruction.
+static bool isData(instruction* ins) {
+    return ins->opcode == OP_data || ins->opcode == OP_intdir;
+}
+
+// Returns the index of the label instruction i branches back to, closing a loop, or NO_INDEX if it does not.
+static uint32_t loopStart(program* p, uint32_t i) {
+    instruction* ins = &p->instructions[i];
+    if (!isPcRelative(ins) || ins->opcode == OP_ldr || ins->opcode == OP_bl || targetOf(ins)->kind != OPERAND_LABEL) {
+        return NO_INDEX;
+    }
+    uint32_t target = p->labelIndex[targetOf(ins)->symbol];
+    return target <= i ? target : NO_INDEX;
+}
+
+// Returns whether control may not fall through from ins to the next instruction.
+static bool endsBlock(instruction* ins) {
+    return (isPcRelative(ins) && ins->opcode != OP_ldr) || ins->opcode == OP_br || ins->opcode == OP_ret || isHalt(ins);
+}
+
+static void addRead(effects* e, uint8_t slot) {
+    if (slot != ZR_INDEX && e->numReads < MAX_EFFECTS) {
+        e->reads[e->numReads++] = slot;
+    }
+}
+
+static void addWrite(effects* e, uint8_t slot, uint32_t latency) {
+    if (slot != ZR_INDEX && e->numWrites < MAX_EFFECTS) {
+        e->writes[e->numWrites] = slot;
+        e->writeLatency[e->numWrites++] = latency;
+    }
+}
+
+// Works out the registers ins reads and writes and how long it takes under costs.
+static void effectsOf(instruction* ins, cost* costs, effects* e) {
+    memset(e, 0, sizeof(effects));
+    cost c = costs[ins->opcode];
+    if (ins->opcode == OP_constant) {
+        // A chain of movz/movn and movks.
+        uint8_t words = instructionSize(ins);
+        c.latency = costs[OP_movz].latency * words;
+        c.issue = costs[OP_movz].issue * words;
+    }
+    e->latency = c.latency;
+    e->issue = c.issue;
+
+    // Stores, branches and compare-and-branch only read their register operands.
+    uint8_t destinations;
+    switch (ins->opcode) {
+        case OP_str: case OP_strb: case OP_strh: case OP_stp:
+        case OP_cbz: case OP_cbnz: case OP_br: case OP_ret:
+        case OP_b: case OP_bl: case OP_nop:
+            destinations = 0;
+            break;
+        case OP_ldp:
+            destinations = 2;
+            break;
+        default:
+            destinations = isConditionalBranch(ins) ? 0 : 1;
+    }
+
+    for (uint8_t i = 0; i < ins->numOperands; i++) {
+        operand* op = &ins->operands[i];
+        if (op->kind == OPERAND_REGISTER) {
+            if (i >= destinations || ins->opcode == OP_movk) {
+                addRead(e, op->reg);
+            }
+            if (i < destinations) {
+                addWrite(e, op->reg, c.latency);
+            }
+        } else if (op->kind == OPERAND_ADDRESS) {
+            addRead(e, op->reg);
+            if (op->mode == ADDRESS_REGISTER) {
+                addRead(e, op->index);
+            } else if (op->mode == ADDRESS_PRE_INDEX || op->mode == ADDRESS_POST_INDEX) {
+                addWrite(e, op->reg, WRITEBACK_LATENCY);
+            }
+        }
+    }
+
+    if (ins->opcode == OP_bl) {
+        addWrite(e, ISA_LINK_REGISTER, c.latency);
+    } else if (ins->opcode == OP_ret && ins->numOperands == 0) {
+        addRead(e, ISA_LINK_REGISTER);
+    }
+    if (ins->opcode == OP_adds || ins->opcode == OP_subs || ins->opcode == OP_ands || ins->opcode == OP_bics) {
+        addWrite(e, FLAGS_SLOT, c.latency);
+    } else if (isConditionalBranch(ins) && ins->opcode != OP_bal && ins->opcode != OP_bnv) {
+        addRead(e, FLAGS_SLOT);
+    }
+}
+
+// Runs instructions first to last passes times in a row, each starting once every register it reads
+// is ready (so issue width is unlimited), into steps. Registers start out ready at cycle 0.
+// Returns the number of steps.
+static uint32_t simulate(program* p, cost* costs, uint32_t first, uint32_t last, uint32_t passes, step* steps) {
+    uint32_t ready[NUM_SLOTS] = {0};
+    uint32_t producer[NUM_SLOTS];
+    for (int slot = 0; slot < NUM_SLOTS; slot++) {
+        producer[slot] = NO_STEP;
+    }
+
+    uint32_t n = 0;
+    for (uint32_t pass = 0; pass < passes; pass++) {
+        for (uint32_t i = first; i <= last; i++) {
+            instruction* ins = &p->instructions[i];
+            if (isData(ins)) {
+                continue;
+            }
+            effects e;
+            effectsOf(ins, costs, &e);
+
+            step* s = &steps[n];
+            s->index = i;
+            s->pass = pass;
+            s->waitedFor = NO_STEP;
+            uint32_t start = 0;
+            for (uint8_t r = 0; r < e.numReads; r++) {
+                uint8_t slot = e.reads[r];
+                if (producer[slot] != NO_STEP && ready[slot] > start) {
+                    start = ready[slot];
+                    s->waitedFor = producer[slot];
+                    s->via = slot;
+                }
+            }
+            s->finish = start + e.latency;
+            for (uint8_t w = 0; w < e.numWrites; w++) {
+                ready[e.writes[w]] = start + e.writeLatency[w];
+                producer[e.writes[w]] = n;
+            }
+            n++;
+        }
+    }
+    return n;
+}
+
+// Cycles to issue instructions first to last one after another.
+static uint32_t issueCycles(program* p, cost* costs, uint32_t first, uint32_t last) {
+    uint32_t cycles = 0;
+    for (uint32_t i = first; i <= last; i++) {
+        effects e;
+        effectsOf(&p->instructions[i], costs, &e);
+        cycles += e.issue;
+    }
+    return cycles;
+}
+
+// Returns the step among steps[from, to) whose result is ready last.
+static uint32_t latestStep(step* steps, uint32_t from, uint32_t to) {
+    uint32_t latest = from;
+    for (uint32_t s = from; s < to; s++) {
+        if (steps[s].finish > steps[latest].finish) {
+            latest = s;
+        }
+    }
+    return latest;
+}
+
+/*
+Report
+*/
+
+static const char* plural(uint32_t n) {
+    return n == 1 ? "" : "s";
+}
+
+static void printSlot(uint8_t slot) {
+    if (slot == FLAGS_SLOT) {
+        printf("flags");
+    } else {
+        printf("x%u", slot);
+    }
+}
+
+// Prints the chain of steps ending at end, oldest link first, as far back as it stays in pass.
+// Every link but the first names the register it waited for.
+static void printChain(program* p, step* steps, uint32_t end, uint32_t pass) {
+    uint32_t length = 1;
+    for (uint32_t s = end; steps[s].waitedFor != NO_STEP && steps[steps[s].waitedFor].pass == pass; s = steps[s].waitedFor) {
+        length++;
+    }
+    uint32_t* links = malloc(length * sizeof(uint32_t));
+    assert(links != NULL);
+    uint32_t s = end;
+    for (uint32_t k = length; k-- > 0; s = steps[s].waitedFor) {
+        links[k] = s;
+    }
+
+    // Long chains show their ends.
+    for (uint32_t k = 0; k < length; k++) {
+        if (length > MAX_CHAIN_SHOWN && k == MAX_CHAIN_SHOWN / 2) {
+            printf("... %u more -> ", length - MAX_CHAIN_SHOWN);
+            k = length - MAX_CHAIN_SHOWN / 2;
+        }
+        step* link = &steps[links[k]];
+        printf("%s (line %u", mnemonics[p->instructions[link->index].opcode], p->lines[link->index]);
+        if (k > 0) {
+            printf(", ");
+            printSlot(link->via);
+        }
+        printf(")%s", k + 1 < length ? " -> " : "");
+    }
+    free(links);
+}
+
+// Prints which instruction set the flags each conditional branch in b reads.
+static void printFlags(program* p, block* b) {
+    uint32_t setter = NO_INDEX;
+    for (uint32_t i = b->first; i <= b->last; i++) {
+        instruction* ins = &p->instructions[i];
+        if (ins->opcode == OP_adds || ins->opcode == OP_subs || ins->opcode == OP_ands || ins->opcode == OP_bics) {
+            setter = i;
+        } else if (isConditionalBranch(ins) && ins->opcode != OP_bal && ins->opcode != OP_bnv) {
+            printf("  flags: %s (line %u) <- ", mnemonics[ins->opcode], p->lines[i]);
+            if (setter == NO_INDEX) {
+                printf("set before the block\n");
+            } else {
+                printf("%s (line %u), %u instruction%s before\n", mnemonics[p->instructions[setter].opcode],
+                       p->lines[setter], i - setter, plural(i - setter));
+            }
+        }
+    }
+}
+
+// Prints the cost of block b, named by the label at its start if it has one.
+static void reportBlock(program* p, cost* costs, block* b, uint32_t number, char* label, step* steps) {
+    uint32_t n = simulate(p, costs, b->first, b->last, 1, steps);
+    uint32_t issue = issueCycles(p, costs, b->first, b->last);
+    uint32_t latest = latestStep(steps, 0, n);
+    uint32_t latency = n > 0 ? steps[latest].finish : 0;
+
+    printf("block %u", number);
+    if (label != NULL) {
+        printf(" (%s)", label);
+    }
+    uint32_t cycles = issue > latency ? issue : latency;
+    printf(", lines %u-%u: %u instruction%s, issue %u, latency %u, about %u cycle%s\n",
+           p->lines[b->first], p->lines[b->last], n, plural(n), issue, latency, cycles, plural(cycles));
+    if (n > 0 && steps[latest].waitedFor != NO_STEP) {
+        printf("  critical chain (%u cycle%s): ", latency, plural(latency));
+        printChain(p, steps, latest, 0);
+        printf("\n");
+    }
+    printFlags(p, b);
+}
+
+// Prints the steady-state cost of one iteration of the loop from first back to last.
+static void reportLoop(program* p, cost* costs, uint32_t first, uint32_t last, char* label, step* steps) {
+    uint32_t n = simulate(p, costs, first, last, LOOP_PASSES, steps);
+    uint32_t perPass = n / LOOP_PASSES;
+    uint32_t issue = issueCycles(p, costs, first, last);
+
+    // Each iteration finishes later than the one before by the latency of the chain carried between them.
+    uint32_t half = latestStep(steps, 0, perPass * (LOOP_PASSES / 2));
+    uint32_t end = latestStep(steps, 0, n);
+    double recurrence = perPass > 0 ? (steps[end].finish - steps[half].finish) / (double) (LOOP_PASSES / 2) : 0;
+
+    printf("loop %s, lines %u-%u: %u instruction%s per iteration, issue %u, recurrence %.1f, about %.1f cycles per iteration\n",
+           label, p->lines[first], p->lines[last], perPass, plural(perPass), issue, recurrence,
+           issue > recurrence ? issue : recurrence);
+
+    // The chain that sets the pace runs through the last iteration into the one before.
+    uint32_t s = end;
+    while (steps[s].waitedFor != NO_STEP && steps[steps[s].waitedFor].pass == LOOP_PASSES - 1) {
+        s = steps[s].waitedFor;
+    }
+    if (recurrence > 0 && steps[end].pass == LOOP_PASSES - 1 && steps[s].waitedFor != NO_STEP) {
+        printf("  carried chain: ");
+        printSlot(steps[s].via);
+        printf(" from the previous iteration -> ");
+        printChain(p, steps, end, LOOP_PASSES - 1);
+        printf("\n");
+    } else {
+        printf("  no dependency carried between iterations\n");
+    }
+}
+
+// Static cost report for the program in the file at path, printed to stdout.
+void analyzeFile(char* path, char* costsPath) {
+    cost costs[NUM_OPCODES];
+    defaultCosts(costs);
+    if (costsPath != NULL) {
+        readCosts(costsPath, costs);
+    }
+
+    symbol_table* st = newSymbolTable();
+    source* src = openSource(path);
+    program p;
+    readProgram(st, src, &p);
+    closeSource(src);
+
+    // Name of the first label at each instruction.
+    char** labels = calloc(p.size + 1, sizeof(char*));
+    assert(labels != NULL);
+    for (uint32_t id = st->size; id-- > 0;) {
+        if (p.labelIndex[id] != NO_INDEX) {
+            labels[p.labelIndex[id]] = st->symbols[id].label;
+        }
+    }
+
+    // Blocks start at labels and after branches; data splits them too.
+    block* blocks = malloc((p.size + 1) * sizeof(block));
+    assert(blocks != NULL);
+    uint32_t numBlocks = 0;
+    bool open = false;
+    for (uint32_t i = 0; i < p.size; i++) {
+        instruction* ins = &p.instructions[i];
+        if (isData(ins) || p.labelled[i]) {
+            open = false;
+        }
+        if (isData(ins)) {
+            continue;
+        }
+        if (!open) {
+            blocks[numBlocks].first = i;
+            numBlocks++;
+            open = true;
+        }
+        blocks[numBlocks - 1].last = i;
+        if (endsBlock(ins)) {
+            open = false;
+        }
+    }
+
+    // Steps are kept for the longest block, or all the iterations simulated of the longest loop.
+    uint32_t numLoops = 0;
+    size_t maxSteps = 1;
+    for (uint32_t b = 0; b < numBlocks; b++) {
+        size_t length = blocks[b].last - blocks[b].first + 1;
+        maxSteps = length > maxSteps ? length : maxSteps;
+    }
+    for (uint32_t i = 0; i < p.size; i++) {
+        uint32_t start = loopStart(&p, i);
+        if (start != NO_INDEX) {
+            size_t length = (size_t) (i - start + 1) * LOOP_PASSES;
+            maxSteps = length > maxSteps ? length : maxSteps;
+            numLoops++;
+        }
+    }
+
+    printf("%s: %u instruction%s in %u block%s, %u loop%s; cost model %s\n", path, p.size, plural(p.size),
+           numBlocks, plural(numBlocks), numLoops, plural(numLoops), costsPath != NULL ? costsPath : "default");
+
+    step* steps = malloc(maxSteps * sizeof(step));
+    assert(steps != NULL);
+    for (uint32_t b = 0; b < numBlocks; b++) {
+        reportBlock(&p, costs, &blocks[b], b, labels[blocks[b].first], steps);
+    }
+    for (uint32_t i = 0; i < p.size; i++) {
+        uint32_t start = loopStart(&p, i);
+        if (start != NO_INDEX) {
+            reportLoop(&p, costs, start, i, labels[start], steps);
+        }
+    }
+
+    free(steps);
+    free(blocks);
+    free(labels);
+    freeProgram(&p);
+    freeSymbolTable(st);
+}
@@ -0,0 +1,10 @@
+#include "defs.h"
+
+// Static cost report for the program in the file at path, printed to stdout. The program is split
+// into basic blocks at labels and after branches, and costed under the model at costsPath (lines of
+// "<mnemonic> <latency> [<issue cycles>]") or, if it is NULL, the default one. Reports, per block,
+// the cycles to issue it, its longest register dependency chain and the flags each conditional
+// branch waits for; per loop (a backward branch to a label), the cycles per iteration in the steady
+// state and the chain carried from one iteration to the next. Memory dependencies and branch
+// mispredictions are not modelled.
+void analyzeFile(char* path, char* costsPath);
@@ -1,84 +1,151 @@
 #include <stdlib.h>
 #include <stdio.h>
-#include <assert.h>
 #include <stdint.h>
-#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <getopt.h>
 #include "defs.h"
 #include "utils.h"
 #include "symbol_table.h"
-#include "tokenize.h"
-#include "branch.h"
-#include "data_processing.h"
-#include "data_transfer.h"
-
-symbol_table* st;
-
-uint32_t (*instructionFunctions[59])(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address) = {
-    &eor, &bge, &subs, &orr, &bics, &sub, &adds, // 6
-    &bic, &and, &negs, &ble, &b, &bal, &br, // 13
-    NULL, &eon, NULL, NULL, &ldr, &movn, &blt, // 20
-    &beq, &mul, &movk, &madd, NULL, &msub, NULL, // 27
-    NULL, &cmn, &intdir, NULL, &neg, NULL, &mvn, // 34
-    &movz, &ands, &str, &mov, &add, NULL, NULL, // 41
-    NULL, &bgt, &mneg, NULL, NULL, &cmp, NULL, // 48
-    NULL, &tst, NULL, NULL, &nop, NULL, &orn, // 55
-    NULL, NULL, &bne
-};
+#include "watch.h"
+#include "assembler.h"
+#include "batch.h"
+#include "cache.h"
+#include "analysis.h"
+
+#define DEFAULT_CACHE_MB 256
+#define BYTES_IN_MB (1024 * 1024)
+
+static void usage(void) {
+    fprintf(stderr, "assemble: ./assemble [-c] [-j <threads>] [-m <map_out>] [-O] [-w] <file_in> <file_out>\n"
+            "          ./assemble --batch <list> [-j <threads>]\n"
+            "          ./assemble --analyze [--costs <model>] <file_in>\n"
+            "          with --cache <dir> [--cache-size <MB>] [--cache-stats], without -c, -m or -w.\n"
+            "          -O takes neither -j nor -m.\n");
+    exit(EXIT_FAILURE);
+}
 
 int main(int argc, char **argv) {
-
-    if (argc < 3) {
-        fprintf(stderr, "assemble: ./assemble <file_in> <file_out>.\n");
-        exit(EXIT_FAILURE);
+    int numThreads = 0;
+    bool watch = false;
+    bool relocatable = false;
+    bool optimize = false;
+    char* mapPath = NULL;
+    char* listPath = NULL;
+    char* cacheDir = NULL;
+    uint64_t cacheMB = DEFAULT_CACHE_MB;
+    bool cacheStats = false;
+    bool analyze = false;
+    char* costsPath = NULL;
+
+    static const struct option longOptions[] = {
+        {"batch", required_argument, NULL, 'b'},
+        {"cache", required_argument, NULL, 'C'},
+        {"cache-size", required_argument, NULL, 'S'},
+        {"cache-stats", no_argument, NULL, 's'},
+        {"analyze", no_argument, NULL, 'a'},
+        {"costs", required_argument, NULL, 'k'},
+        {NULL, 0, NULL, 0},
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "cj:m:Ow", longOptions, NULL)) != -1) {
+        if (opt == 'j' && atoi(optarg) > 0) {
+            numThreads = atoi(optarg);
+        } else if (opt == 'c') {
+            relocatable = true;
+        } else if (opt == 'm') {
+            mapPath = optarg;
+        } else if (opt == 'O') {
+            optimize = true;
+        } else if (opt == 'w') {
+            watch = true;
+        } else if (opt == 'b') {
+            listPath = optarg;
+        } else if (opt == 'C') {
+            cacheDir = optarg;
+        } else if (opt == 'S' && atoll(optarg) > 0) {
+            cacheMB = atoll(optarg);
+        } else if (opt == 's') {
+            cacheStats = true;
+        } else if (opt == 'a') {
+            analyze = true;
+        } else if (opt == 'k') {
+            costsPath = optarg;
+        } else {
+            optind = argc;
+            break;
+        }
     }
 
-    // Create empty symbol table
-    st = newSymbolTable();
-    assert(st != NULL);
-
-    // Read file into buffer. Buffer is initalized as NULL pointers.
-    char buffer[MAX_LINES][MAX_CHARS_IN_LINE] = {(char)0};
-    int numRead = readFile(buffer, argv[1]);
-
-
-    // Remove blank lines
-    // numRead = skipBlanks(buffer, numRead);
-
-    // First pass: Create symbol table associating labels with memory addresses
-    uint8_t numIns = populateSymbolTable(buffer, st, numRead);
+    // Analysis only reads the source; it writes nothing but its report.
+    if (analyze || costsPath != NULL) {
+        if (!analyze || argc - optind != 1 || watch || relocatable || optimize || mapPath != NULL
+                || listPath != NULL || cacheDir != NULL || cacheStats) {
+            usage();
+        }
+        analyzeFile(argv[optind], costsPath);
+        return EXIT_SUCCESS;
+    }
 
-    // Remove labels from buffer:
-    //skipLines(buffer, &isLabel, numRead); 
+    // The cache holds flat binaries, and only knows a source by its own bytes.
+    binary_cache* cache = NULL;
+    if (cacheDir != NULL) {
+        if (watch || relocatable || mapPath != NULL) {
+            usage();
+        }
+        cache = openCache(cacheDir, cacheMB * BYTES_IN_MB);
+    } else if (cacheStats) {
+        usage();
+    }
+    if (cacheStats) {
+        printCacheStats(cache);
+        if (listPath == NULL && optind == argc) {
+            closeCache(cache);
+            return EXIT_SUCCESS;
+        }
+    }
 
-    // Allocate memory for instructions
-    uint32_t* instructions = (uint32_t*) calloc(numIns, sizeof(uint32_t));
-    assert(instructions != NULL);
+    // A batch takes its files from the list and only combines with -j and the cache.
+    if (listPath != NULL) {
+        if (optind != argc || watch || relocatable || optimize || mapPath != NULL) {
+            usage();
+        }
+        bool ok = assembleBatch(listPath, numThreads > 0 ? numThreads : sysconf(_SC_NPROCESSORS_ONLN), cache);
+        if (cache != NULL) {
+            closeCache(cache);
+        }
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
 
-    // Second pass: Read in each instruction and .int directive, write instructions into array
-    instruction instr = {.opcode = "", .operands = {""}};
-    instruction* instrptr = &instr;
-    uint32_t address = 0; 
-    for (int i = 0; i < numRead; i++) {
-        trimWhitespace(buffer[i]);
-        if (!isLabel(buffer[i]) && !isBlankLine(buffer[i])) {
-            
+    // A symbol map describes a flat binary, so it cannot go with an object. It follows the
+    // source line by line, so it cannot describe optimized code either. The optimizer reads the
+    // whole program on one thread, so it does not take -j.
+    if (argc - optind < 2 || (mapPath != NULL && (relocatable || optimize)) || (optimize && numThreads > 0)) {
+        usage();
+    }
+    char* inPath = argv[optind];
+    char* outPath = argv[optind + 1];
 
-            // Tokenize instruction into opcode and operands.
-            tokenizeInstruction(buffer[i], instrptr);
+    // Watch mode keeps running, patching the binary as the source is edited.
+    if (watch) {
+        watchSource(inPath, outPath);
+    }
 
-            // Hash opcode to get correct function. This function will return the word to be written to memory given the operands.
-            // Divide address by INSTRUCTION_SIZE so we don't add blank lines.
-            instructions[address / INSTRUCTION_SIZE] 
-                = instructionFunctions[hash(instrptr->opcode)](instrptr->operands[0], instrptr->operands[1], instrptr->operands[2],
-                                                               instrptr->operands[3], address);
+    // Objects are combined into a binary by link.
+    if (relocatable) {
+        assembleObject(inPath, outPath);
+        return EXIT_SUCCESS;
+    }
 
-            // Increment address (blank lines and labels don't need to increment address)
-            address += INSTRUCTION_SIZE; 
-        } 
+    if (cache != NULL) {
+        assembleCached(cache, inPath, numThreads, optimize, outPath);
+        closeCache(cache);
+        return EXIT_SUCCESS;
     }
 
-    writeBinary(argv[2], instructions, numIns);
-    free(st);
-    free(instructions);
+    uint32_t size;
+    uint32_t* words = assembleFile(inPath, numThreads, optimize, mapPath, &size);
+    writeBinary(outPath, words, size);
+    free(words);
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,102 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "defs.h"
+#include "utils.h"
+#include "symbol_table.h"
+#include "instructions.h"
+#include "directives.h"
+#include "source.h"
+#include "output.h"
+#include "parallel.h"
+#include "relocatable.h"
+#include "symbol_map.h"
+#include "optimize.h"
+#include "assembler.h"
+
+// Assembles src into out one line at a time, followed by the literal pool. References to labels
+// defined further down are recorded and patched into the output when the label is reached.
+static void assembleSerial(symbol_table* st, source* src, output* out) {
+    uint32_t words[MAX_INSTRUCTION_WORDS];
+    line_scan scan;
+    while (scanLine(src, &scan)) {
+        // Blank lines and labels don't take up an address.
+        if (isBlankScan(&scan)) {
+            continue;
+        }
+        copyScanned(src, &scan);
+        char* line = src->line;
+
+        if (scan.colon) {
+            defineLabel(st, line, outputAddress(out), out);
+        } else if (isDataDirective(line)) {
+            uint32_t size = dataSize(line, src->lineNumber);
+            writeData(line, src->lineNumber, reserveWords(out, size), size);
+        } else {
+            uint8_t n = assembleLine(st, line, src->lineNumber, outputAddress(out), words);
+            for (uint8_t i = 0; i < n; i++) {
+                emitWord(out, words[i]);
+            }
+        }
+    }
+    definePool(st, outputAddress(out), out);
+    emitPool(st, out);
+}
+
+// Assembles the file at path, using numThreads worker threads (0 encodes as the file is read).
+// Returns the words, which the caller frees, and sets size to their number. Exits on errors.
+// With optimize, redundant instructions are removed first (see assembleOptimized), on one thread.
+// Unless mapPath is NULL, a symbol map for the binary is written there.
+uint32_t* assembleFile(char* path, int numThreads, bool optimize, char* mapPath, uint32_t* size) {
+    // Source is streamed line by line, so its size is only bounded by memory.
+    source* src = openSource(path);
+    uint32_t* words = assembleSource(src, numThreads, optimize, mapPath, size);
+    closeSource(src);
+    return words;
+}
+
+// Like assembleFile, but assembles src, which must not have been read from yet. src is left open.
+uint32_t* assembleSource(source* src, int numThreads, bool optimize, char* mapPath, uint32_t* size) {
+    // Create empty symbol table
+    symbol_table* st = newSymbolTable();
+    assert(st != NULL);
+    output* out = newOutput();
+
+    // Encode each instruction and data directive, either as it is read or split across threads.
+    if (optimize) {
+        assembleOptimized(st, src, out);
+    } else if (numThreads > 0) {
+        assembleParallel(st, src, out, numThreads);
+    } else {
+        assembleSerial(st, src, out);
+    }
+    checkUndefinedLabels(st);
+    if (mapPath != NULL) {
+        writeSymbolMap(src, st, mapPath);
+    }
+
+    freeSymbolTable(st);
+
+    uint32_t* words = out->words;
+    *size = out->size;
+    free(out);
+    return words;
+}
+
+// Assembles the file at inPath into a relocatable object at outPath. Labels the file does not
+// define are left for link to resolve against other objects.
+void assembleObject(char* inPath, char* outPath) {
+    symbol_table* st = newSymbolTable();
+    source* src = openSource(inPath);
+    output* out = newOutput();
+
+    // Encoded serially: workers only see a frozen table, which cannot take in undefined labels.
+    assembleSerial(st, src, out);
+    writeObject(outPath, st, out);
+
+    closeSource(src);
+    freeSymbolTable(st);
+    freeOutput(out);
+}
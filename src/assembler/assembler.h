@@ -0,0 +1,16 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include "source.h"
+
+// Assembles the file at path, using numThreads worker threads (0 encodes as the file is read).
+// Returns the words, which the caller frees, and sets size to their number. Exits on errors.
+// With optimize, redundant instructions are removed first (see assembleOptimized), on one thread.
+// Unless mapPath is NULL, a symbol map for the binary is written there.
+uint32_t* assembleFile(char* path, int numThreads, bool optimize, char* mapPath, uint32_t* size);
+
+// Like assembleFile, but assembles src, which must not have been read from yet. src is left open.
+uint32_t* assembleSource(source* src, int numThreads, bool optimize, char* mapPath, uint32_t* size);
+
+// Assembles the file at inPath into a relocatable object at outPath. Labels the file does not
+// define are left for link to resolve against other objects.
+void assembleObject(char* inPath, char* outPath);
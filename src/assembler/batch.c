@@ -0,0 +1,207 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "defs.h"
+#include "utils.h"
+#include "source.h"
+#include "assembler.h"
+#include "cache.h"
+#include "batch.h"
+
+#define INITIAL_JOB_CAPACITY 64
+#define BYTES_IN_MB (1024.0 * 1024.0)
+
+// One (input, output) pair of the list.
+typedef struct {
+    char* inPath;
+    char* outPath;
+    uint32_t lineNumber; // in the list
+} batch_job;
+
+typedef struct {
+    pthread_t thread;
+    batch_job* current; // job being assembled, or NULL
+} batch_worker;
+
+// Jobs shared by the workers, which take them in list order.
+typedef struct {
+    batch_job* jobs;
+    uint32_t numJobs;
+    uint32_t next;
+    uint64_t sourceBytes;
+    uint64_t words;
+    pthread_mutex_t lock;
+    batch_worker* workers;
+    int numWorkers;
+    binary_cache* cache; // or NULL
+    batch_job* failed;   // first job in list order with an error, or NULL
+} batch;
+
+// Batch being assembled; the workers share it.
+static batch* running;
+
+// Returns the time since an arbitrary fixed point, in seconds.
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+// Reads the list at path: one "<file_in> <file_out>" pair per line, blank lines ignored.
+static void readJobs(char* path, batch* b) {
+    source* src = openSource(path);
+    uint32_t capacity = INITIAL_JOB_CAPACITY;
+    b->jobs = malloc(capacity * sizeof(batch_job));
+    assert(b->jobs != NULL);
+    b->numJobs = 0;
+
+    while (nextLine(src)) {
+        char* line = src->line;
+        trimWhitespace(line);
+        if (isBlankLine(line)) {
+            continue;
+        }
+
+        // Split in place at the whitespace between the two paths.
+        char* outPath = line + strcspn(line, " \t");
+        if (*outPath != '\0') {
+            *outPath++ = '\0';
+            outPath += strspn(outPath, " \t");
+        }
+        if (*outPath == '\0' || outPath[strcspn(outPath, " \t")] != '\0') {
+            fprintf(stderr, "assemble: %s: line %u is not \"<file_in> <file_out>\".\n", path, src->lineNumber);
+            exit(EXIT_FAILURE);
+        }
+
+        if (b->numJobs == capacity) {
+            capacity *= 2;
+            b->jobs = realloc(b->jobs, capacity * sizeof(batch_job));
+            assert(b->jobs != NULL);
+        }
+        batch_job* job = &b->jobs[b->numJobs++];
+        job->inPath = strdup(line);
+        job->outPath = strdup(outPath);
+        assert(job->inPath != NULL && job->outPath != NULL);
+        job->lineNumber = src->lineNumber;
+    }
+    closeSource(src);
+}
+
+// Takes the next job of the list, or NULL once all are taken or a job has failed.
+static batch_job* takeJob(batch* b) {
+    pthread_mutex_lock(&b->lock);
+    batch_job* job = b->next < b->numJobs && b->failed == NULL ? &b->jobs[b->next++] : NULL;
+    pthread_mutex_unlock(&b->lock);
+    return job;
+}
+
+// Records that job had an error, so that no worker takes another.
+static void failJob(batch* b, batch_job* job) {
+    pthread_mutex_lock(&b->lock);
+    if (b->failed == NULL || job < b->failed) {
+        b->failed = job;
+    }
+    pthread_mutex_unlock(&b->lock);
+}
+
+// Assembles jobs until there are none left. Each has its own symbol table inside assembleFile.
+// An error in a source stops the worker, which leaves the files it has written whole, and the
+// others stop once their current job is done.
+static void* runWorker(void* arg) {
+    batch_worker* w = arg;
+    batch* b = running;
+
+    error_trap trap;
+    if (setjmp(trap.jump) != 0) {
+        catchErrors(NULL);
+        failJob(b, w->current);
+        return NULL;
+    }
+    catchErrors(&trap);
+
+    while ((w->current = takeJob(b)) != NULL) {
+        batch_job* job = w->current;
+        struct stat info;
+        uint64_t bytes = stat(job->inPath, &info) == 0 ? (uint64_t) info.st_size : 0;
+
+        uint32_t size;
+        if (b->cache != NULL) {
+            size = assembleCached(b->cache, job->inPath, 0, false, job->outPath);
+        } else {
+            uint32_t* words = assembleFile(job->inPath, 0, false, NULL, &size);
+            writeBinary(job->outPath, words, size);
+            free(words);
+        }
+
+        pthread_mutex_lock(&b->lock);
+        b->sourceBytes += bytes;
+        b->words += size;
+        pthread_mutex_unlock(&b->lock);
+    }
+    catchErrors(NULL);
+    return NULL;
+}
+
+// Assembles every pair listed in the file at listPath on numThreads worker threads, each source
+// serially, through cache unless it is NULL. Ends with a throughput summary (and the cache's hit
+// rate) on stderr. Stops at the first source with an error, once the jobs already started are
+// done, and returns false.
+bool assembleBatch(char* listPath, int numThreads, binary_cache* cache) {
+    batch b;
+    readJobs(listPath, &b);
+    b.cache = cache;
+    b.next = 0;
+    b.sourceBytes = 0;
+    b.words = 0;
+    b.failed = NULL;
+    pthread_mutex_init(&b.lock, NULL);
+
+    if ((uint32_t) numThreads > b.numJobs) {
+        numThreads = b.numJobs > 0 ? b.numJobs : 1;
+    }
+    b.numWorkers = numThreads;
+    b.workers = calloc(numThreads, sizeof(batch_worker));
+    assert(b.workers != NULL);
+    running = &b;
+
+    double start = now();
+    for (int t = 0; t < numThreads; t++) {
+        if (pthread_create(&b.workers[t].thread, NULL, runWorker, &b.workers[t]) != 0) {
+            fprintf(stderr, "assemble: cannot start worker thread.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (int t = 0; t < numThreads; t++) {
+        pthread_join(b.workers[t].thread, NULL);
+    }
+    double elapsed = now() - start;
+    running = NULL;
+
+    bool ok = b.failed == NULL;
+    if (!ok) {
+        fprintf(stderr, "assemble: batch stopped at %s (list line %u).\n", b.failed->inPath, b.failed->lineNumber);
+    } else {
+        fprintf(stderr, "assemble: %u files, %.2f MB of source, %llu words in %.3f s on %d threads "
+                "(%.0f files/s, %.2f MB/s).\n",
+                b.numJobs, b.sourceBytes / BYTES_IN_MB, (unsigned long long) b.words, elapsed, numThreads,
+                elapsed > 0 ? b.numJobs / elapsed : 0, elapsed > 0 ? b.sourceBytes / BYTES_IN_MB / elapsed : 0);
+        if (cache != NULL) {
+            reportCache(cache);
+        }
+    }
+
+    for (uint32_t i = 0; i < b.numJobs; i++) {
+        free(b.jobs[i].inPath);
+        free(b.jobs[i].outPath);
+    }
+    free(b.jobs);
+    free(b.workers);
+    pthread_mutex_destroy(&b.lock);
+    return ok;
+}
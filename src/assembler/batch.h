@@ -0,0 +1,8 @@
+#include <stdbool.h>
+#include "cache.h"
+
+// Assembles every pair listed in the file at listPath on numThreads worker threads, each source
+// serially, through cache unless it is NULL. Ends with a throughput summary (and the cache's hit
+// rate) on stderr. Stops at the first source with an error, once the jobs already started are
+// done, and returns false.
+bool assembleBatch(char* listPath, int numThreads, binary_cache* cache);
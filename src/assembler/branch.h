@@ -1,11 +1,8 @@
 #include <stdint.h>
+#include "defs.h"
 
-uint32_t b(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
-uint32_t br(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
-uint32_t beq(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
-uint32_t bne(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
-uint32_t bge(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
-uint32_t ble(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
-uint32_t bal(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
-uint32_t bgt(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
-uint32_t blt(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
+// Encoder families for branch instructions; bits holds the base encoding (and condition code).
+uint32_t unconditionalBranch(symbol_table* st, instruction* ins, uint32_t address, uint32_t bits);
+uint32_t registerBranch(symbol_table* st, instruction* ins, uint32_t address, uint32_t bits);
+uint32_t compareBranch(symbol_table* st, instruction* ins, uint32_t address, uint32_t bits);
+uint32_t conditionalBranch(symbol_table* st, instruction* ins, uint32_t address, uint32_t bits);
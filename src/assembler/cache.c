@@ -0,0 +1,402 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include "defs.h"
+#include "utils.h"
+#include "source.h"
+#include "assembler.h"
+#include "cache.h"
+
+#define KEY_LENGTH 32 // hex digits of a 128-bit key
+#define ENTRY_SUFFIX ".bin"
+#define STATS_NAME "stats"
+#define EVICT_TO 0.9 // eviction stops at this fraction of the limit, so it is not needed again at once
+#define HASH_PRIME_1 0x9e3779b185ebca87ull
+#define HASH_PRIME_2 0xc2b2ae3d27d4eb4full
+#define INITIAL_ENTRY_CAPACITY 256
+#define BYTES_IN_MB (1024.0 * 1024.0)
+
+/*
+Hashing
+*/
+
+static uint64_t rotateLeft(uint64_t x, int n) {
+    return (x << n) | (x >> (64 - n));
+}
+
+// Final avalanche, so every input bit affects every output bit.
+static uint64_t mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= HASH_PRIME_1;
+    h ^= h >> 29;
+    h *= HASH_PRIME_2;
+    return h ^ (h >> 32);
+}
+
+// Hashes size bytes of data eight at a time into two 64-bit lanes, continuing from key.
+static void hashBytes(const char* data, size_t size, uint64_t key[2]) {
+    uint64_t a = key[0];
+    uint64_t b = key[1];
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t w;
+        memcpy(&w, data + i, sizeof(w));
+        a = rotateLeft((a ^ w) * HASH_PRIME_1, 31);
+        b = rotateLeft((b ^ w) * HASH_PRIME_2, 27) + a;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, data + i, size - i);
+    a = rotateLeft((a ^ tail) * HASH_PRIME_1, 31);
+    b = rotateLeft((b ^ tail) * HASH_PRIME_2, 27) + a;
+
+    key[0] = mix(a ^ size);
+    key[1] = mix(b + key[0]);
+}
+
+// Hash of the running assembler, so a rebuilt assembler never sees binaries of the old one.
+static void hashAssembler(uint64_t key[2]) {
+    key[0] = HASH_PRIME_1;
+    key[1] = HASH_PRIME_2;
+    struct stat info;
+    if (stat("/proc/self/exe", &info) == 0 && info.st_size > 0) {
+        source* exe = openSource("/proc/self/exe");
+        hashBytes(exe->data, exe->size, key);
+        closeSource(exe);
+    } else {
+        char* build = __DATE__ " " __TIME__;
+        hashBytes(build, strlen(build), key);
+    }
+}
+
+/*
+Entries
+*/
+
+// Returns the path of file name in the cache directory; the caller frees it.
+static char* cachePath(binary_cache* cache, char* name) {
+    size_t length = strlen(cache->dir) + 1 + strlen(name) + 1;
+    char* path = malloc(length);
+    assert(path != NULL);
+    snprintf(path, length, "%s/%s", cache->dir, name);
+    return path;
+}
+
+// Returns whether name looks like an entry: KEY_LENGTH hex digits then ENTRY_SUFFIX.
+static bool isEntryName(char* name) {
+    return strlen(name) == KEY_LENGTH + strlen(ENTRY_SUFFIX) && strspn(name, "0123456789abcdef") == KEY_LENGTH
+        && strcmp(name + KEY_LENGTH, ENTRY_SUFFIX) == 0;
+}
+
+// Copies the entry at path to outPath, setting size to its number of words, and marks it as just
+// used. Returns false if there is none.
+static bool copyEntry(char* path, char* outPath, uint32_t* size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    uint32_t* words = NULL;
+    bool ok = fstat(fd, &info) == 0 && info.st_size % sizeof(uint32_t) == 0;
+    if (ok) {
+        words = malloc(info.st_size > 0 ? info.st_size : 1);
+        assert(words != NULL);
+        size_t got = 0;
+        ssize_t n;
+        while (got < (size_t) info.st_size && (n = read(fd, (char*) words + got, info.st_size - got)) > 0) {
+            got += n;
+        }
+        ok = got == (size_t) info.st_size;
+    }
+    // Recency for eviction is the modification time.
+    if (ok) {
+        futimens(fd, NULL);
+    }
+    close(fd);
+
+    if (ok) {
+        *size = info.st_size / sizeof(uint32_t);
+        writeBinary(outPath, words, *size);
+    }
+    free(words);
+    return ok;
+}
+
+// Returns whether the source may assemble differently with the same bytes (it reads other files).
+static bool dependsOnFiles(source* src) {
+    char* directive = ".incbin";
+    for (char* dot = src->data; (dot = memchr(dot, '.', src->data + src->size - dot)) != NULL; dot++) {
+        if ((size_t) (src->data + src->size - dot) >= strlen(directive) && strncmp(dot, directive, strlen(directive)) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+Eviction and statistics
+*/
+
+// Cache entry found while evicting.
+typedef struct {
+    char name[KEY_LENGTH + sizeof(ENTRY_SUFFIX)];
+    struct timespec used;
+    uint64_t bytes;
+} cache_entry;
+
+static int compareUse(const void* a, const void* b) {
+    const struct timespec* x = &((const cache_entry*) a)->used;
+    const struct timespec* y = &((const cache_entry*) b)->used;
+    if (x->tv_sec != y->tv_sec) {
+        return x->tv_sec < y->tv_sec ? -1 : 1;
+    }
+    return (x->tv_nsec > y->tv_nsec) - (x->tv_nsec < y->tv_nsec);
+}
+
+// Lists the entries of the cache and their total size. The caller frees the list.
+// Returns NULL, having printed why, if the directory cannot be read.
+static cache_entry* listEntries(binary_cache* cache, uint32_t* numEntries, uint64_t* bytes) {
+    DIR* dir = opendir(cache->dir);
+    if (dir == NULL) {
+        fprintf(stderr, "assemble: cannot read cache directory %s\n", cache->dir);
+        return NULL;
+    }
+    uint32_t capacity = INITIAL_ENTRY_CAPACITY;
+    cache_entry* entries = malloc(capacity * sizeof(cache_entry));
+    assert(entries != NULL);
+    *numEntries = 0;
+    *bytes = 0;
+
+    struct dirent* d;
+    while ((d = readdir(dir)) != NULL) {
+        struct stat info;
+        if (!isEntryName(d->d_name) || fstatat(dirfd(dir), d->d_name, &info, 0) != 0) {
+            continue;
+        }
+        if (*numEntries == capacity) {
+            capacity *= 2;
+            entries = realloc(entries, capacity * sizeof(cache_entry));
+            assert(entries != NULL);
+        }
+        cache_entry* e = &entries[(*numEntries)++];
+        strcpy(e->name, d->d_name);
+        e->used = info.st_mtim;
+        e->bytes = info.st_size;
+        *bytes += info.st_size;
+    }
+    closedir(dir);
+    return entries;
+}
+
+// Removes the least recently used entries until they take at most EVICT_TO of the limit, setting
+// bytes to the size of what is left. Returns false if the cache cannot be listed.
+static bool evict(binary_cache* cache, uint64_t* left) {
+    uint32_t numEntries;
+    uint64_t bytes;
+    cache_entry* entries = listEntries(cache, &numEntries, &bytes);
+    if (entries == NULL) {
+        return false;
+    }
+    qsort(entries, numEntries, sizeof(cache_entry), compareUse);
+
+    for (uint32_t i = 0; i < numEntries && bytes > cache->limit * EVICT_TO; i++) {
+        char* path = cachePath(cache, entries[i].name);
+        if (unlink(path) == 0) {
+            bytes -= entries[i].bytes;
+        }
+        free(path);
+    }
+    free(entries);
+    *left = bytes;
+    return true;
+}
+
+// Reads the lifetime counters of the cache; missing counters read as zero.
+static void readStats(FILE* stats, uint64_t counters[3]) {
+    rewind(stats);
+    if (fscanf(stats, "%llu %llu %llu", (unsigned long long*) &counters[0], (unsigned long long*) &counters[1],
+               (unsigned long long*) &counters[2]) != 3) {
+        counters[0] = counters[1] = counters[2] = 0;
+    }
+}
+
+// Opens and locks the stats file, which holds "<hits> <misses> <bytes of entries>".
+static FILE* lockStats(binary_cache* cache) {
+    char* path = cachePath(cache, STATS_NAME);
+    int fd = open(path, O_RDWR | O_CREAT, 0666);
+    free(path);
+    if (fd < 0 || flock(fd, LOCK_EX) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        fprintf(stderr, "assemble: cannot update cache statistics in %s\n", cache->dir);
+        assemblyError();
+    }
+    FILE* stats = fdopen(fd, "r+");
+    assert(stats != NULL);
+    return stats;
+}
+
+// Adds hits, misses and bytes of new entries to the cache's counters, evicting entries if it has
+// grown past its limit. Returns the bytes of entries it holds now.
+static uint64_t updateStats(binary_cache* cache, uint64_t hits, uint64_t misses, uint64_t added) {
+    // Other assemblers may share the directory; the lock keeps the counters consistent.
+    FILE* stats = lockStats(cache);
+    uint64_t counters[3];
+    readStats(stats, counters);
+    counters[0] += hits;
+    counters[1] += misses;
+    counters[2] += added;
+    // The lock must be released before an error unwinds, or every later update would wait on it.
+    if (counters[2] > cache->limit && !evict(cache, &counters[2])) {
+        fclose(stats);
+        assemblyError();
+    }
+
+    rewind(stats);
+    if (ftruncate(fileno(stats), 0) == 0) {
+        fprintf(stats, "%llu %llu %llu\n", (unsigned long long) counters[0], (unsigned long long) counters[1],
+                (unsigned long long) counters[2]);
+    }
+    fclose(stats);
+    return counters[2];
+}
+
+/*
+Cache
+*/
+
+// Opens the cache in directory dir, creating it if needed, with a limit of limit bytes of entries.
+binary_cache* openCache(char* dir, uint64_t limit) {
+    if (mkdir(dir, 0777) != 0 && errno != EEXIST) {
+        fprintf(stderr, "assemble: cannot create cache directory %s\n", dir);
+        exit(EXIT_FAILURE);
+    }
+    binary_cache* cache = malloc(sizeof(binary_cache));
+    assert(cache != NULL);
+    cache->dir = dir;
+    cache->limit = limit;
+    hashAssembler(cache->version);
+    cache->hits = 0;
+    cache->misses = 0;
+    cache->added = 0;
+    cache->stored = updateStats(cache, 0, 0, 0);
+    pthread_mutex_init(&cache->lock, NULL);
+    return cache;
+}
+
+// Counts bytes of a new entry, evicting at once if the cache has grown past its limit rather than
+// waiting for closeCache, so a long batch keeps to the limit too.
+static void addBytes(binary_cache* cache, uint64_t bytes) {
+    pthread_mutex_lock(&cache->lock);
+    cache->added += bytes;
+    uint64_t unrecorded = 0;
+    if (cache->stored + cache->added > cache->limit) {
+        unrecorded = cache->added;
+        cache->added = 0;
+    }
+    pthread_mutex_unlock(&cache->lock);
+    if (unrecorded == 0) {
+        return;
+    }
+
+    // The stats file's own lock orders this against other workers and other assemblers.
+    uint64_t stored = updateStats(cache, 0, 0, unrecorded);
+    pthread_mutex_lock(&cache->lock);
+    cache->stored = stored;
+    pthread_mutex_unlock(&cache->lock);
+}
+
+// Assembles the file at inPath to outPath, copying the binary from the cache if the same source
+// was assembled before (with the same optimize and the same assembler). Misses are added to it.
+// Returns the number of words.
+uint32_t assembleCached(binary_cache* cache, char* inPath, int numThreads, bool optimize, char* outPath) {
+    // The binary is assembled from the same bytes as the key is made of, so a file that changes
+    // meanwhile cannot store one source's binary under another's key.
+    source* src = openSource(inPath);
+    if (dependsOnFiles(src)) {
+        uint32_t size;
+        uint32_t* words = assembleSource(src, numThreads, optimize, NULL, &size);
+        closeSource(src);
+        writeBinary(outPath, words, size);
+        free(words);
+        return size;
+    }
+
+    uint64_t key[2] = {cache->version[0], cache->version[1]};
+    char flags = optimize;
+    hashBytes(&flags, sizeof(flags), key);
+    hashBytes(src->data, src->size, key);
+    char name[KEY_LENGTH + sizeof(ENTRY_SUFFIX)];
+    snprintf(name, sizeof(name), "%016llx%016llx" ENTRY_SUFFIX, (unsigned long long) key[0], (unsigned long long) key[1]);
+    char* path = cachePath(cache, name);
+
+    uint32_t size;
+    bool hit = copyEntry(path, outPath, &size);
+    if (!hit) {
+        uint32_t* words = assembleSource(src, numThreads, optimize, NULL, &size);
+        writeBinary(outPath, words, size);
+        // Entries appear whole too, so concurrent assemblers only ever see whole ones. Only the
+        // writer that creates an entry counts its bytes.
+        if (writeNewBinary(path, words, size)) {
+            addBytes(cache, (uint64_t) size * sizeof(uint32_t));
+        }
+        free(words);
+    }
+    closeSource(src);
+    free(path);
+
+    pthread_mutex_lock(&cache->lock);
+    if (hit) {
+        cache->hits++;
+    } else {
+        cache->misses++;
+    }
+    pthread_mutex_unlock(&cache->lock);
+    return size;
+}
+
+// Adds this run's counters to the cache's, evicts entries if it has grown past its limit
+// and frees the cache.
+void closeCache(binary_cache* cache) {
+    updateStats(cache, cache->hits, cache->misses, cache->added);
+    pthread_mutex_destroy(&cache->lock);
+    free(cache);
+}
+
+// Prints this run's hit rate to stderr.
+void reportCache(binary_cache* cache) {
+    uint32_t lookups = cache->hits + cache->misses;
+    fprintf(stderr, "assemble: cache: %u hits, %u misses (%.1f%% hit rate).\n",
+            cache->hits, cache->misses, lookups > 0 ? 100.0 * cache->hits / lookups : 0);
+}
+
+// Prints the cache's lifetime hit rate and current size to stdout.
+void printCacheStats(binary_cache* cache) {
+    FILE* stats = lockStats(cache);
+    uint64_t counters[3];
+    readStats(stats, counters);
+    fclose(stats);
+
+    uint32_t numEntries;
+    uint64_t bytes;
+    cache_entry* entries = listEntries(cache, &numEntries, &bytes);
+    if (entries == NULL) {
+        assemblyError();
+    }
+    free(entries);
+    uint64_t lookups = counters[0] + counters[1];
+    printf("%s: %llu hits, %llu misses (%.1f%% hit rate); %u entries, %.2f MB of %.2f MB.\n",
+           cache->dir, (unsigned long long) counters[0], (unsigned long long) counters[1],
+           lookups > 0 ? 100.0 * counters[0] / lookups : 0, numEntries, bytes / BYTES_IN_MB,
+           cache->limit / BYTES_IN_MB);
+}
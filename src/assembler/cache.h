@@ -0,0 +1,40 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+// Directory of assembled binaries, each named by a 128-bit hash of its source, the -O flag and
+// the assembler binary. Least recently used entries are removed once the total passes a limit.
+// The directory also holds lifetime hit and miss counts. Several assemblers may share it.
+typedef struct {
+    char* dir;
+    uint64_t limit;      // bytes of entries
+    uint64_t version[2]; // hash of the assembler that every key starts from
+    uint32_t hits;       // this run
+    uint32_t misses;
+    uint64_t added;      // bytes of entries created this run and not yet in the stats
+    uint64_t stored;     // bytes of entries according to the stats, when last read
+    pthread_mutex_t lock; // batch workers share the counters
+} binary_cache;
+
+// Opens the cache in directory dir, creating it if needed, with a limit of limit bytes of entries.
+binary_cache* openCache(char* dir, uint64_t limit);
+
+// Assembles the file at inPath to outPath, copying the binary from the cache if the same source
+// was assembled before (with the same optimize and the same assembler). Misses are added to it.
+// Sources with .incbin depend on other files, so they are always assembled. Returns the number of words.
+uint32_t assembleCached(binary_cache* cache, char* inPath, int numThreads, bool optimize, char* outPath);
+
+// Adds this run's counters to the cache's, evicts entries if it has grown past its limit
+// and frees the cache.
+void closeCache(binary_cache* cache);
+
+// Prints this run's hit rate to stderr.
+void reportCache(binary_cache* cache);
+
+// Prints the cache's lifetime hit rate and current size to stdout.
+void printCacheStats(binary_cache* cache);
+
+#endif
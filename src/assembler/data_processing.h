@@ -1,28 +1,8 @@
 #include <stdint.h>
+#include "defs.h"
 
-uint32_t add(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
-uint32_t sub(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
-uint32_t adds(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
-uint32_t subs(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
-uint32_t cmp(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
-uint32_t cmn(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
-uint32_t neg(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
-uint32_t negs(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
-uint32_t and(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
-uint32_t ands(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
-uint32_t bic(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
-uint32_t bics(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
-uint32_t eor(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
-uint32_t orr(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
-uint32_t eon(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
-uint32_t orn(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
-uint32_t tst(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
-uint32_t movk(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
-uint32_t movn(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
-uint32_t movz(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
-uint32_t mov(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
-uint32_t mvn(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
-uint32_t madd(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
-uint32_t msub(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
-uint32_t mul(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
-uint32_t mneg(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
+// Encoder families for data processing instructions; bits selects the operation within the family.
+uint32_t arithmeticInstructions(symbol_table* st, instruction* ins, uint32_t address, uint32_t bits);
+uint32_t logicalInstructions(symbol_table* st, instruction* ins, uint32_t address, uint32_t bits);
+uint32_t wideMoveInstructions(symbol_table* st, instruction* ins, uint32_t address, uint32_t bits);
+uint32_t multiplyInstructions(symbol_table* st, instruction* ins, uint32_t address, uint32_t bits);
@@ -1,123 +1,84 @@
 #include <stdint.h>
-#include <string.h>
-#include <stdlib.h>
-#include <stdio.h>
-#include <string.h>
-#include <stdio.h>
-#include <regex.h>
+#include <stdbool.h>
 #include "utils.h"
-#include "symbol_table.h"
+#include "data_transfer.h"
 
 /*
 DATA TRANSFER
 */
 
-#define SDT_BASE 0xb8000000
-#define LOADLIT_BASE 0x18000000
+// Encodes a single register transfer of (1 << size) bytes.
+static uint32_t transferInstruction(instruction* ins, uint32_t bits, uint32_t size) {
+    operand* addr = &ins->operands[1];
+    uint32_t instr = ISA_SDT_BASE | bits | ISA_PUT(SDT_SIZE, size) | ISA_PUT(SDT_RT, ins->operands[0].reg) |
+    ISA_PUT(SDT_XN, addr->reg);
 
-// Shifted bases for addressing modes
-#define REG_OFFSET_BASE 0x00206800
-#define PRE_INDEX_BASE 0x00000c00
-#define POST_INDEX_BASE 0x00000400
+    switch (addr->mode) {
+        case ADDRESS_PRE_INDEX:
+            return instr | ISA_PUT(SDT_SIMM9, addr->imm) | ISA_PRE_INDEX_BASE;
+        case ADDRESS_POST_INDEX:
+            return instr | ISA_PUT(SDT_SIMM9, addr->imm) | ISA_POST_INDEX_BASE;
+        case ADDRESS_REGISTER:
+            return instr | ISA_PUT(SDT_XM, addr->index) | ISA_REG_OFFSET_BASE;
+        default:
+            // Unsigned offset (zero if omitted), scaled by the transfer size
+            return instr | ISA_PUT(SDT_IMM12, addr->imm >> size) | ISA_PUT(SDT_U, 1);
+    }
+}
 
-// Single Data Processing Constants
-#define SDT_REGISTEROFFSET_BIT 10 // tests for register offset transfer type
-#define SDT_UNSIGNED_OFFSET_FLAG_BIT 24
-#define SDT_LBIT_POS 22 // load bit
-#define SDT_UBIT_POS 24 // unsigned offset bit
-#define SDT_SFBIT_POS 30 // 32bit bit
-#define SDT_RT_START 0
-#define SDT_XN_START 5
-#define SDT_IBIT_POS 11 // for pre/post index
-#define SDT_SIMM9_START 12 // for pre/post index
-#define SDT_XM_START 16 // for register offset
-#define SDT_IMM12_START 10 // for unsigned offset
-#define SDT_SIMM19_START 5 // for load literal
+// Word or double word transfer depending on the register width.
+uint32_t dataTransferInstruction(symbol_table* st, instruction* ins, uint32_t address, uint32_t bits) {
+    return transferInstruction(ins, bits, ISA_SIZE_WORD + ins->operands[0].is64);
+}
 
-extern symbol_table* st;
+// Byte or halfword transfer; the size is part of bits.
+uint32_t narrowTransferInstruction(symbol_table* st, instruction* ins, uint32_t address, uint32_t bits) {
+    return transferInstruction(ins, bits, ISA_GET(SDT_SIZE, bits));
+}
 
-uint32_t dataTransferInstruction(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address) {
-    uint32_t instr = SDT_BASE | (is64BitReg(arg1) << SDT_SFBIT_POS) | (getRegNum(arg1) << SDT_RT_START);
+/*
+REGISTER PAIR TRANSFER
+*/
 
-    char* xn = (char*) malloc(MAX_CHARS_IN_LINE * sizeof(char));
-    char* xm = (char*) malloc(MAX_CHARS_IN_LINE * sizeof(char));
-    char* imm = (char*) malloc(MAX_CHARS_IN_LINE * sizeof(char));
-    char* simm = (char*) malloc(MAX_CHARS_IN_LINE * sizeof(char));
-    // Pre-Indexed
-    if (strstr(arg2, "!")) {
-        xn = strtok(arg2, ",");
-        simm = strtok(NULL, "]");
-        return instr | (getRegNum(xn) << SDT_XN_START) | ((getImmediate(simm) & generateMask(SIMM9_LEN)) << SDT_SIMM9_START) | PRE_INDEX_BASE; 
-    }
-    // Post-Indexed (3rd argument #<simm> exists)
-    if (strcmp(arg3, "") != 0) {
-        sscanf(arg2, "[%s]", xn);
-        return instr | (getRegNum(xn) << SDT_XN_START) | ((getImmediate(arg3) & generateMask(SIMM9_LEN)) << SDT_SIMM9_START) | POST_INDEX_BASE; 
-    }
+uint32_t pairTransferInstruction(symbol_table* st, instruction* ins, uint32_t address, uint32_t bits) {
+    operand* rt = &ins->operands[0];
+    operand* addr = &ins->operands[2];
+    int64_t scale = rt->is64 ? BYTES_IN_64BIT : BYTES_IN_32BIT;
+    uint32_t instr = ISA_PAIR_BASE | bits | ISA_PUT(PAIR_SF, rt->is64) | ISA_PUT(SDT_RT, rt->reg) |
+    ISA_PUT(PAIR_RT2, ins->operands[1].reg) | ISA_PUT(SDT_XN, addr->reg);
 
-    // Register Offset
-    regex_t regex;
-    int reg_comp_value;
-    reg_comp_value = regcomp(&regex, "\[\\w+, \\w+\\]", 0);
-    if (reg_comp_value != 0) {
-        fprintf(stderr, "regex compilation error");
-    }
-    if (regexec(&regex, arg2, 0, NULL, 0) == 0 && strstr(arg2, "#") == NULL){
-        xn = strtok(arg2, "[,]");
-        xm = strtok(NULL, "[,]");
-        return instr | (getRegNum(xn) << SDT_XN_START) | (getRegNum(xm) << SDT_XM_START) | REG_OFFSET_BASE;
+    // Signed offset unless pre- or post-indexed
+    uint32_t mode = ISA_PAIR_OFFSET;
+    if (addr->mode == ADDRESS_PRE_INDEX) {
+        mode = ISA_PAIR_PRE_INDEX;
+    } else if (addr->mode == ADDRESS_POST_INDEX) {
+        mode = ISA_PAIR_POST_INDEX;
     }
 
-    // Unsigned Immediate Offset
-    if (regexec(&regex, arg2, 0, NULL, 0) == 0 && strstr(arg2, "#") != NULL){
-        // Add # back to start of imm
-        xn = strtok(arg2, "[,]");
-        imm = strtok(NULL, "[,]");
-        // Determine imm12 encoding based on register bitwidth
-        uint32_t imm12;
-        if (is64BitReg(arg1)) {
-            imm12 = calculateOffset(imm, address, IMM12_LEN) / BYTES_IN_64BIT;
-        } else {
-            imm12 = calculateOffset(imm, address, IMM12_LEN) / BYTES_IN_32BIT;
-        }
-        return instr | (getRegNum(xn) << SDT_XN_START) | (imm12 << SDT_IMM12_START) | (1 << SDT_UBIT_POS);
-    }
-    
-    // Zero Unsigned Offset
-    if (sscanf(arg2, "[%s]", xn)) {
-        return instr | (getRegNum(xn) << SDT_XN_START) | (1 << SDT_UNSIGNED_OFFSET_FLAG_BIT);
-    }
-    // Offset operand is not of valid form
-    exit(EXIT_FAILURE);
+    // imm7 is scaled by the register size
+    return instr | ISA_PUT(PAIR_MODE, mode) | ISA_PUT(PAIR_IMM7, addr->imm / scale);
 }
 
-uint32_t ldr(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address) {
-    if (strncmp(arg2, "[", 1) != 0) {
-        return LOADLIT_BASE | (getRegNum(arg1) << SDT_RT_START) | ((calculateOffset(arg2, address, SIMM19_LEN) / INSTRUCTION_SIZE) << SDT_SIMM19_START) | (is64BitReg(arg1) << SDT_SFBIT_POS);
+// Loads are either from a literal address or share the data transfer encoding with the L bit set.
+uint32_t loadInstruction(symbol_table* st, instruction* ins, uint32_t address, uint32_t bits) {
+    operand* rt = &ins->operands[0];
+    if (ins->operands[1].kind != OPERAND_ADDRESS) {
+        return ISA_LOADLIT_BASE | ISA_PUT(SDT_RT, rt->reg) | ISA_PUT(SDT_SF, rt->is64) |
+        encodeOffset(st, &ins->operands[1], address, SDT_SIMM19_START, SDT_SIMM19_LEN);
     } else {
-        return dataTransferInstruction(arg1, arg2, arg3, arg4, address) | (1 << SDT_LBIT_POS);
+        return dataTransferInstruction(st, ins, address, bits);
     }
 }
 
-uint32_t str(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address) {
-    // L bit is 0.
-    return dataTransferInstruction(arg1, arg2, arg3, arg4, address);
-}
-
 /*
 SPECIAL INSTRUCTIONS AND DIRECTIVE
 */
 
-#define SPECIAL_NOP_CODE 0xd503201f
-
-uint32_t nop(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address) {
-    return SPECIAL_NOP_CODE;
+// Instructions without operands are fully described by their bits.
+uint32_t fixedInstruction(symbol_table* st, instruction* ins, uint32_t address, uint32_t bits) {
+    return bits;
 }
 
-uint32_t intdir(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address) {
-    // Treat number as hex if it starts with "0x"
-    if (strncmp(arg1, "0x", 2) == 0) {
-        return (uint32_t) strtol(arg1, NULL, HEX_BASE);
-    }
-    return (uint32_t) strtol(arg1, NULL, DENARY_BASE);
+uint32_t intDirective(symbol_table* st, instruction* ins, uint32_t address, uint32_t bits) {
+    return (uint32_t) ins->operands[0].imm;
 }
@@ -1,6 +1,10 @@
 #include <stdint.h>
+#include "defs.h"
 
-uint32_t ldr(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
-uint32_t str(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
-uint32_t nop(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
-uint32_t intdir(char* arg1, char* arg2, char* arg3, char* arg4, uint32_t address);
+// Encoder families for data transfer instructions, special instructions and directives.
+uint32_t dataTransferInstruction(symbol_table* st, instruction* ins, uint32_t address, uint32_t bits);
+uint32_t narrowTransferInstruction(symbol_table* st, instruction* ins, uint32_t address, uint32_t bits);
+uint32_t pairTransferInstruction(symbol_table* st, instruction* ins, uint32_t address, uint32_t bits);
+uint32_t loadInstruction(symbol_table* st, instruction* ins, uint32_t address, uint32_t bits);
+uint32_t fixedInstruction(symbol_table* st, instruction* ins, uint32_t address, uint32_t bits);
+uint32_t intDirective(symbol_table* st, instruction* ins, uint32_t address, uint32_t bits);
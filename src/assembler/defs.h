@@ -1,47 +1,128 @@
 #ifndef MAX_WORDS_IN_LINE
 
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "isa.h"
+
 // Parser Constants
 #define MAX_WORDS_IN_LINE 5
 #define MAX_OPERANDS 4
-#define MAX_CHARS_IN_LINE 128 // Arbitrary choice
-#define MAX_LABELS 128 // Arbitrary Choice
-#define MAX_LINES 128 // Arbitrary Choice
 #define DENARY_BASE 10
 #define HEX_BASE 16
 
 // Instruction Constants
 #define INSTRUCTION_SIZE 4 // in bytes
 #define ZR_INDEX 31
-#define OPERAND_WZR "wzr"
-#define OPERAND_XZR "xzr"
-#define MASK_OFFSET 2
-#define SIMM19_LEN 19
-#define SIMM9_LEN 9
-#define SIMM26_LEN 26
-#define IMM12_LEN 12
+#define NO_ZERO_REGISTER (-1) // mnemonic is not an alias
 
 //Memory Constants
 #define BYTES_IN_64BIT 8
 #define BYTES_IN_32BIT 4
 
-// Structure for symbol table
-// Has to be defined this way since symbol is self-referential
-typedef struct symbol symbol;
-struct symbol {
-    char* label;
-    uint64_t address;
-    symbol* next; // linked list structure
- };
+// Symbol table constants
+#define INITIAL_SYMBOL_CAPACITY 64 // power of two
+#define NO_SYMBOL UINT32_MAX
+#define LABEL_ARENA_BLOCK_SIZE 65536
+
+#define INITIAL_FIXUP_CAPACITY 64
+#define NO_FIXUP UINT32_MAX
+#define INITIAL_OUTPUT_CAPACITY 1024 // in words
+#define INITIAL_POOL_CAPACITY 16
+#define MAX_INSTRUCTION_WORDS 4 // longest expansion of a pseudo-instruction
+
+// Reference to a label that was not yet defined; patched into the output once it is.
+typedef struct {
+    uint32_t address; // of the referencing instruction
+    uint8_t start;    // offset field within the instruction
+    uint8_t len;
+    uint32_t next;    // next fixup for the same label, or NO_FIXUP
+} fixup;
+
+// Label known to the assembler, identified by its index in the symbol table.
+typedef struct {
+    char* label; // interned in the table's arena
+    uint32_t hash;
+    uint32_t address;
+    bool defined;    // false while the label has only been referenced
+    bool pooled;     // is a literal pool entry
+    uint32_t fixups; // first pending fixup, or NO_FIXUP
+} symbol;
+
+// Block of interned label text. Blocks are never moved, so labels stay valid.
+typedef struct label_block label_block;
+struct label_block {
+    label_block* next;
+    size_t used;
+    size_t capacity;
+    char text[];
+};
 
+// Symbols in order of first appearance, indexed by an open addressing hash table on their labels.
 typedef struct {
-    symbol* first;
-    uint8_t size; // max size < MAX_LABELS
+    symbol* symbols;
+    uint32_t size;
+    uint32_t symbolCapacity;
+    uint32_t* slots;   // symbol ids, NO_SYMBOL when empty
+    uint32_t capacity; // always a power of two
+    bool frozen;       // no new labels; set while other threads read the table
+    label_block* arena;
+    fixup* fixups;
+    uint32_t numFixups;
+    uint32_t fixupCapacity;
+    uint32_t* pool;     // symbols of the literal pool entries, in order; named "=<value>"
+    uint64_t* poolValues;
+    uint32_t poolSize;
+    uint32_t poolCapacity;
 } symbol_table;
 
-// Structure for assembler file instructions: operation mneumonic and up to four operands
+// Assembled words, grown as instructions are emitted.
+typedef struct {
+    uint32_t* words;
+    uint32_t size;
+    uint32_t capacity;
+} output;
+
+// Structure for assembler file instructions: operation mneumonic and up to four operands, as text
 typedef struct {
     char* opcode;
     char* operands[MAX_OPERANDS];
+} instruction_text;
+
+// Opcodes, one per mnemonic in the ISA tables (aliases become their target).
+#define ISA_OPCODE(mnemonic, name, ...) OP_##name,
+// OP_constant is the pseudo-instruction that loads a constant into a register (mov xn, #imm or ldr xn, =imm).
+// OP_data stands for the words of a data directive in a parsed program (see optimize.c).
+typedef enum { ISA_INSTRUCTIONS(ISA_OPCODE) OP_constant, OP_data, NUM_OPCODES } OPCODE;
+#undef ISA_OPCODE
+
+typedef enum {
+    OPERAND_NONE, OPERAND_REGISTER, OPERAND_IMMEDIATE, OPERAND_SHIFT, OPERAND_ADDRESS, OPERAND_LABEL, OPERAND_CONSTANT
+} OPERAND_KIND;
+
+// Addressing modes of [xn...] operands.
+typedef enum { ADDRESS_OFFSET, ADDRESS_REGISTER, ADDRESS_PRE_INDEX, ADDRESS_POST_INDEX } ADDRESS_MODE;
+
+// Parsed operand. Which fields are meaningful depends on kind:
+//   register: reg, is64       immediate: imm       shift: shift (ISA_SHIFT_*), imm
+//   address:  reg (base), mode, index (register offset) or imm (offset)
+//   label:    symbol            constant: imm ("=imm", only seen while parsing)
+typedef struct {
+    uint8_t kind;
+    uint8_t reg;
+    bool is64;
+    uint8_t shift;
+    uint8_t mode;
+    uint8_t index;
+    uint32_t symbol;
+    int64_t imm;
+} operand;
+
+// Parsed instruction, ready to be encoded.
+typedef struct {
+    uint8_t opcode;
+    uint8_t numOperands;
+    operand operands[MAX_OPERANDS];
 } instruction;
 
 #endif
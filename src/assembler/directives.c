@@ -0,0 +1,280 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "defs.h"
+#include "directives.h"
+#include "utils.h"
+
+#define MAX_FILL_SIZE 8 // bytes in the widest .fill value
+#define BITS_IN_BYTE 8
+
+typedef enum { DIRECTIVE_WORD, DIRECTIVE_QUAD, DIRECTIVE_SPACE, DIRECTIVE_FILL, DIRECTIVE_INCBIN } DIRECTIVE;
+
+static const struct {
+    const char* name;
+    DIRECTIVE kind;
+} directives[] = {
+    {".word", DIRECTIVE_WORD},
+    {".quad", DIRECTIVE_QUAD},
+    {".space", DIRECTIVE_SPACE},
+    {".fill", DIRECTIVE_FILL},
+    {".incbin", DIRECTIVE_INCBIN},
+};
+
+#define NUM_DIRECTIVES (sizeof(directives) / sizeof(directives[0]))
+
+// Looks up the directive a line (not NUL terminated) starts with. Sets args to what follows it.
+// Returns false if the line does not start with one.
+static bool findDirective(char* start, size_t length, DIRECTIVE* kind, char** args) {
+    size_t name = 0;
+    while (name < length && !isspace((unsigned char) start[name])) {
+        name++;
+    }
+    for (uint32_t i = 0; i < NUM_DIRECTIVES; i++) {
+        if (strlen(directives[i].name) == name && strncmp(start, directives[i].name, name) == 0) {
+            *kind = directives[i].kind;
+            *args = start + name;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Returns whether a trimmed line is a bulk data directive.
+bool isDataDirective(char* line) {
+    DIRECTIVE kind;
+    char* args;
+    return *line == '.' && findDirective(line, strlen(line), &kind, &args);
+}
+
+// Returns whether a raw line (not NUL terminated) is a bulk data directive.
+bool isDataText(char* start, size_t length) {
+    while (length > 0 && isspace((unsigned char) *start)) {
+        start++;
+        length--;
+    }
+    DIRECTIVE kind;
+    char* args;
+    return length > 0 && *start == '.' && findDirective(start, length, &kind, &args);
+}
+
+static void invalidDirective(char* line, uint32_t lineNumber) {
+    fprintf(stderr, "Invalid directive (%s) on line %u.\n", line, lineNumber);
+    assemblyError();
+}
+
+// Parses the next comma separated number (decimal or 0x-prefixed hexadecimal, optionally
+// negative and prefixed with #) and moves cursor past it. Returns false at the end of the list.
+static bool nextValue(char** cursor, uint64_t* value, char* line, uint32_t lineNumber) {
+    char* text = *cursor;
+    while (isspace((unsigned char) *text)) {
+        text++;
+    }
+    if (*text == '\0') {
+        return false;
+    }
+    if (*text == '#') {
+        text++;
+    }
+    bool negative = *text == '-';
+    if (negative) {
+        text++;
+    }
+
+    char* end;
+    *value = strtoull(text, &end, strncmp(text, "0x", 2) == 0 ? HEX_BASE : DENARY_BASE);
+    if (end == text) {
+        invalidDirective(line, lineNumber);
+    }
+    if (negative) {
+        *value = -*value;
+    }
+
+    while (isspace((unsigned char) *end)) {
+        end++;
+    }
+    if (*end == ',') {
+        end++;
+        if (*end == '\0') {
+            invalidDirective(line, lineNumber);
+        }
+    } else if (*end != '\0') {
+        invalidDirective(line, lineNumber);
+    }
+    *cursor = end;
+    return true;
+}
+
+// Parses the next number of the list, or returns otherwise if the list has ended.
+static uint64_t optionalValue(char** cursor, uint64_t otherwise, char* line, uint32_t lineNumber) {
+    uint64_t value;
+    return nextValue(cursor, &value, line, lineNumber) ? value : otherwise;
+}
+
+// Splits the quoted path of .incbin out of args in place.
+static char* incbinPath(char* args, char* line, uint32_t lineNumber) {
+    while (isspace((unsigned char) *args)) {
+        args++;
+    }
+    char* close = *args == '"' ? strchr(args + 1, '"') : NULL;
+    if (close == NULL || close[1] != '\0' || close == args + 1) {
+        invalidDirective(line, lineNumber);
+    }
+    *close = '\0';
+    return args + 1;
+}
+
+// Bytes .space or .fill emits, with the pattern repeated through them.
+typedef struct {
+    uint64_t bytes;
+    uint8_t pattern[MAX_FILL_SIZE];
+    uint8_t size; // bytes of pattern that repeat
+} fill_region;
+
+// Parses ".space count[, byte]" or ".fill count[, size[, value]]".
+static void parseFill(DIRECTIVE kind, char* args, fill_region* fill, char* line, uint32_t lineNumber) {
+    uint64_t count;
+    if (!nextValue(&args, &count, line, lineNumber)) {
+        invalidDirective(line, lineNumber);
+    }
+    uint64_t size = kind == DIRECTIVE_SPACE ? 1 : optionalValue(&args, 1, line, lineNumber);
+    uint64_t value = optionalValue(&args, 0, line, lineNumber);
+    if (*args != '\0' || (size != 1 && size != 2 && size != 4 && size != 8) || count > UINT32_MAX) {
+        invalidDirective(line, lineNumber);
+    }
+
+    fill->bytes = count * size;
+    fill->size = size;
+    for (uint8_t i = 0; i < size; i++) {
+        fill->pattern[i] = value >> (i * BITS_IN_BYTE);
+    }
+    // The output is made of whole words.
+    if (fill->bytes % INSTRUCTION_SIZE != 0 || fill->bytes / INSTRUCTION_SIZE > UINT32_MAX) {
+        fprintf(stderr, "Directive (%s) on line %u must emit a whole number of words.\n", line, lineNumber);
+        assemblyError();
+    }
+}
+
+// Returns the number of words the directive on a trimmed line emits. Exits if it is malformed
+// (or, for .incbin, the file cannot be read). The line is left as it was.
+uint32_t dataSize(char* line, uint32_t lineNumber) {
+    DIRECTIVE kind;
+    char* args;
+    findDirective(line, strlen(line), &kind, &args);
+
+    uint64_t words = 0;
+    uint64_t value;
+    switch (kind) {
+        case DIRECTIVE_WORD:
+        case DIRECTIVE_QUAD:
+            while (nextValue(&args, &value, line, lineNumber)) {
+                words += kind == DIRECTIVE_QUAD ? BYTES_IN_64BIT / INSTRUCTION_SIZE : 1;
+            }
+            if (words == 0) {
+                invalidDirective(line, lineNumber);
+            }
+            break;
+        case DIRECTIVE_SPACE:
+        case DIRECTIVE_FILL: {
+            fill_region fill;
+            parseFill(kind, args, &fill, line, lineNumber);
+            words = fill.bytes / INSTRUCTION_SIZE;
+            break;
+        }
+        case DIRECTIVE_INCBIN: {
+            char* path = incbinPath(args, line, lineNumber);
+            struct stat info;
+            if (stat(path, &info) != 0 || !S_ISREG(info.st_mode)) {
+                fprintf(stderr, "ERROR: Cannot open file: %s\n", path);
+                assemblyError();
+            }
+            // The closing quote was cut off to find the path.
+            path[strlen(path)] = '"';
+            words = ((uint64_t) info.st_size + INSTRUCTION_SIZE - 1) / INSTRUCTION_SIZE;
+            break;
+        }
+    }
+    if (words > UINT32_MAX) {
+        invalidDirective(line, lineNumber);
+    }
+    return words;
+}
+
+// Fills bytes of dest with pattern repeated. Each copy doubles the filled prefix, so a region
+// takes a handful of memcpys however large it is.
+static void fillBytes(uint8_t* dest, uint64_t bytes, uint8_t* pattern, uint8_t size) {
+    if (size == 1) {
+        memset(dest, pattern[0], bytes);
+        return;
+    }
+    uint64_t filled = size < bytes ? size : bytes;
+    memcpy(dest, pattern, filled);
+    while (filled < bytes) {
+        uint64_t copy = filled < bytes - filled ? filled : bytes - filled;
+        memcpy(dest + filled, dest, copy);
+        filled += copy;
+    }
+}
+
+// Reads the whole file at path into size words, padding the last one with zeros.
+static void readIncbin(char* path, uint32_t* words, uint32_t size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "ERROR: Cannot open file: %s\n", path);
+        assemblyError();
+    }
+    size_t bytes = (size_t) size * sizeof(uint32_t);
+    size_t got = 0;
+    ssize_t n;
+    while (got < bytes && (n = read(fd, (char*) words + got, bytes - got)) > 0) {
+        got += n;
+    }
+    close(fd);
+    if (got + INSTRUCTION_SIZE <= bytes) {
+        fprintf(stderr, "ERROR: File changed while being assembled: %s\n", path);
+        assemblyError();
+    }
+    memset((char*) words + got, 0, bytes - got);
+}
+
+// Writes the size words (as returned by dataSize) of the directive on a trimmed line into words.
+void writeData(char* line, uint32_t lineNumber, uint32_t* words, uint32_t size) {
+    DIRECTIVE kind;
+    char* args;
+    findDirective(line, strlen(line), &kind, &args);
+
+    uint64_t value;
+    switch (kind) {
+        case DIRECTIVE_WORD:
+            while (nextValue(&args, &value, line, lineNumber)) {
+                *words++ = (uint32_t) value;
+            }
+            break;
+        case DIRECTIVE_QUAD:
+            // Little endian, like the rest of the binary.
+            while (nextValue(&args, &value, line, lineNumber)) {
+                *words++ = (uint32_t) value;
+                *words++ = (uint32_t) (value >> 32);
+            }
+            break;
+        case DIRECTIVE_SPACE:
+        case DIRECTIVE_FILL: {
+            fill_region fill;
+            parseFill(kind, args, &fill, line, lineNumber);
+            fillBytes((uint8_t*) words, fill.bytes, fill.pattern, fill.size);
+            break;
+        }
+        case DIRECTIVE_INCBIN: {
+            char* path = incbinPath(args, line, lineNumber);
+            readIncbin(path, words, size);
+            path[strlen(path)] = '"';
+            break;
+        }
+    }
+}
@@ -0,0 +1,24 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Bulk data directives, which emit any number of words from one line:
+//   .word v, ...                   32-bit values
+//   .quad v, ...                   64-bit values, low word first
+//   .space bytes[, byte]           bytes copies of byte (0 by default)
+//   .fill count[, size[, value]]   count copies of the size (1, 2, 4 or 8) byte value
+//   .incbin "path"                 the contents of a file, padded with zeros to a word
+// .space and .fill must come to a whole number of words.
+
+// Returns whether a trimmed line is a bulk data directive.
+bool isDataDirective(char* line);
+
+// Returns whether a raw line (not NUL terminated) is a bulk data directive.
+bool isDataText(char* start, size_t length);
+
+// Returns the number of words the directive on a trimmed line emits. Exits if it is malformed
+// (or, for .incbin, the file cannot be read). The line is left as it was.
+uint32_t dataSize(char* line, uint32_t lineNumber);
+
+// Writes the size words (as returned by dataSize) of the directive on a trimmed line into words.
+void writeData(char* line, uint32_t lineNumber, uint32_t* words, uint32_t size);
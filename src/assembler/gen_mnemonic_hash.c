@@ -0,0 +1,135 @@
+// Build-time generator for mnemonic_hash.h.
+//
+// Finds a displacement for every bucket of the mnemonic set in ../common/isa.h so that
+// mnemonicSlot() sends each mnemonic to its own slot, then prints the table sizes,
+// the displacements and each encoder's slot as macros.
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "isa.h"
+#include "perfect_hash.h"
+
+#define MAX_DISPLACEMENT UINT16_MAX
+
+typedef struct {
+    const char* mnemonic;
+    const char* name; // encoder function name in instructions.c
+    uint32_t hash;
+    uint32_t slot;
+} entry;
+
+#define ISA_ENTRY(mnemonic, name, ...) {mnemonic, #name, 0, 0},
+static entry entries[] = {
+    ISA_INSTRUCTIONS(ISA_ENTRY)
+    ISA_ALIASES(ISA_ENTRY)
+};
+#undef ISA_ENTRY
+
+#define NUM_ENTRIES (sizeof(entries) / sizeof(entries[0]))
+
+static uint32_t numBuckets;
+static uint32_t numSlots;
+static uint16_t* displacements;
+
+// Orders buckets by decreasing size so the most constrained are placed first.
+static uint32_t* bucketSizes;
+static int compareBuckets(const void* a, const void* b) {
+    uint32_t sa = bucketSizes[*(const uint32_t*) a];
+    uint32_t sb = bucketSizes[*(const uint32_t*) b];
+    return (sa < sb) - (sa > sb);
+}
+
+// Tries to place every bucket with numSlots slots. Returns false if some bucket has no displacement.
+static bool place(void) {
+    bool* used = calloc(numSlots, sizeof(bool));
+    uint32_t claims[NUM_ENTRIES];
+    uint32_t* order = malloc(numBuckets * sizeof(uint32_t));
+    bucketSizes = calloc(numBuckets, sizeof(uint32_t));
+    displacements = calloc(numBuckets, sizeof(uint16_t));
+
+    for (uint32_t i = 0; i < NUM_ENTRIES; i++) {
+        bucketSizes[entries[i].hash % numBuckets]++;
+    }
+    for (uint32_t b = 0; b < numBuckets; b++) {
+        order[b] = b;
+    }
+    qsort(order, numBuckets, sizeof(uint32_t), compareBuckets);
+
+    bool placed = true;
+    for (uint32_t k = 0; k < numBuckets && placed && bucketSizes[order[k]] > 0; k++) {
+        uint32_t bucket = order[k];
+        placed = false;
+
+        for (uint32_t d = 0; d <= MAX_DISPLACEMENT && !placed; d++) {
+            // Claim slots for the bucket's members, undoing the claims if any slot is taken.
+            placed = true;
+            uint32_t claimed = 0;
+            for (uint32_t i = 0; i < NUM_ENTRIES && placed; i++) {
+                if (entries[i].hash % numBuckets != bucket) {
+                    continue;
+                }
+                uint32_t slot = mixMnemonic(entries[i].hash, d) & (numSlots - 1);
+                if (used[slot]) {
+                    placed = false;
+                } else {
+                    used[slot] = true;
+                    entries[i].slot = slot;
+                    claims[claimed++] = slot;
+                }
+            }
+            if (placed) {
+                displacements[bucket] = d;
+            } else {
+                while (claimed > 0) {
+                    used[claims[--claimed]] = false;
+                }
+            }
+        }
+    }
+
+    free(used);
+    free(order);
+    free(bucketSizes);
+    return placed;
+}
+
+int main(void) {
+    // A duplicated mnemonic (or a full 32-bit hash collision) can never be separated.
+    for (uint32_t i = 0; i < NUM_ENTRIES; i++) {
+        entries[i].hash = hashMnemonic(entries[i].mnemonic);
+        for (uint32_t j = 0; j < i; j++) {
+            if (entries[i].hash == entries[j].hash) {
+                fprintf(stderr, "gen_mnemonic_hash: %s and %s cannot be told apart.\n",
+                        entries[i].mnemonic, entries[j].mnemonic);
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    // Roughly two mnemonics per bucket and at least a fifth of the slots free.
+    numBuckets = (NUM_ENTRIES + 1) / 2;
+    numSlots = 1;
+    while (numSlots * 4 < NUM_ENTRIES * 5) {
+        numSlots *= 2;
+    }
+    while (!place()) {
+        free(displacements);
+        numSlots *= 2;
+    }
+
+    printf("// Generated by gen_mnemonic_hash from the ISA tables; do not edit.\n");
+    printf("#define NUM_MNEMONIC_BUCKETS %u\n", numBuckets);
+    printf("#define NUM_INSTRUCTION_HASHES %u\n", numSlots);
+    printf("#define MNEMONIC_DISPLACEMENTS {");
+    for (uint32_t b = 0; b < numBuckets; b++) {
+        printf("%s%u", b == 0 ? "" : ", ", displacements[b]);
+    }
+    printf("}\n");
+    for (uint32_t i = 0; i < NUM_ENTRIES; i++) {
+        printf("#define MNEMONIC_SLOT_%s %u\n", entries[i].name, entries[i].slot);
+    }
+
+    free(displacements);
+    return EXIT_SUCCESS;
+}
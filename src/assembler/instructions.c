@@ -0,0 +1,193 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include "defs.h"
+#include "utils.h"
+#include "instructions.h"
+#include "directives.h"
+#include "branch.h"
+#include "data_processing.h"
+#include "data_transfer.h"
+#include "perfect_hash.h"
+#include "mnemonic_hash.h"
+#include "tokenize.h"
+#include "parse.h"
+
+/*
+Encoders
+*/
+
+typedef struct {
+    encoder family;
+    uint32_t bits;
+} encoder_entry;
+
+#define ISA_ENCODER(mnemonic, name, family, bits) [OP_##name] = {&family, (bits)},
+static const encoder_entry encoders[NUM_OPCODES] = {
+    ISA_INSTRUCTIONS(ISA_ENCODER)
+};
+#undef ISA_ENCODER
+
+// Encodes a parsed instruction into its word.
+uint32_t encodeInstruction(symbol_table* st, instruction* ins, uint32_t address) {
+    const encoder_entry* entry = &encoders[ins->opcode];
+    return entry->family(st, ins, address, entry->bits);
+}
+
+/*
+Constants
+*/
+
+#define HALFWORD_MASK 0xffff
+
+// Number of wide moves that build value from halfwords of fill: a movz (fill 0) or movn (fill ffff)
+// for the first halfword that differs from fill, then a movk for every other one.
+static uint8_t wideMoveCount(uint64_t value, int halfwords, uint64_t fill) {
+    uint8_t count = 0;
+    for (int i = 0; i < halfwords; i++) {
+        count += ((value >> (i * ISA_HW_SHIFT)) & HALFWORD_MASK) != fill;
+    }
+    return count;
+}
+
+// Number of words in the shortest movz/movn + movk sequence that loads value into a register.
+uint8_t constantLength(uint64_t value, bool is64) {
+    int halfwords = is64 ? BYTES_IN_64BIT / 2 : BYTES_IN_32BIT / 2;
+    uint8_t zeros = wideMoveCount(value, halfwords, 0);
+    uint8_t ones = wideMoveCount(value, halfwords, HALFWORD_MASK);
+    uint8_t count = zeros <= ones ? zeros : ones;
+    return count > 0 ? count : 1;
+}
+
+// Encodes the constant pseudo-instruction as the shortest movz/movn + movk sequence.
+static uint8_t constantWords(symbol_table* st, instruction* ins, uint32_t address, uint32_t* words) {
+    operand* rd = &ins->operands[0];
+    int halfwords = rd->is64 ? BYTES_IN_64BIT / 2 : BYTES_IN_32BIT / 2;
+    uint64_t value = ins->operands[1].imm;
+
+    // movn fills the other halfwords with ones, movz with zeros; use whichever leaves fewer movks.
+    bool inverted = wideMoveCount(value, halfwords, HALFWORD_MASK) < wideMoveCount(value, halfwords, 0);
+    uint64_t fill = inverted ? HALFWORD_MASK : 0;
+    bool allFill = wideMoveCount(value, halfwords, fill) == 0;
+
+    instruction move;
+    memset(&move, 0, sizeof(move));
+    move.numOperands = 3;
+    move.operands[0] = *rd;
+    move.operands[1].kind = OPERAND_IMMEDIATE;
+    move.operands[2].kind = OPERAND_SHIFT;
+    move.operands[2].shift = ISA_SHIFT_LSL;
+
+    uint8_t n = 0;
+    for (int i = 0; i < halfwords; i++) {
+        uint64_t halfword = (value >> (i * ISA_HW_SHIFT)) & HALFWORD_MASK;
+        // A value that is all fill still takes one move, of its lowest halfword.
+        if (halfword == fill && !(allFill && i == 0)) {
+            continue;
+        }
+        if (n == 0) {
+            move.opcode = inverted ? OP_movn : OP_movz;
+            move.operands[1].imm = inverted ? ~halfword & HALFWORD_MASK : halfword;
+        } else {
+            move.opcode = OP_movk;
+            move.operands[1].imm = halfword;
+        }
+        move.operands[2].imm = i * ISA_HW_SHIFT;
+        words[n] = encodeInstruction(st, &move, address + n * INSTRUCTION_SIZE);
+        n++;
+    }
+    return n;
+}
+
+/*
+Assembling lines
+*/
+
+// Number of words a parsed instruction assembles to.
+uint8_t instructionSize(instruction* ins) {
+    if (ins->opcode == OP_constant) {
+        return constantLength(ins->operands[1].imm, ins->operands[0].is64);
+    }
+    return 1;
+}
+
+// Encodes a parsed instruction, which may be a pseudo-instruction, into words. Returns their number.
+uint8_t encodeWords(symbol_table* st, instruction* ins, uint32_t address, uint32_t* words) {
+    if (ins->opcode == OP_constant) {
+        return constantWords(st, ins, address, words);
+    }
+    words[0] = encodeInstruction(st, ins, address);
+    return 1;
+}
+
+// Tokenizes and parses one trimmed instruction line; exits on an unknown mnemonic.
+static void parseLine(symbol_table* st, char* line, uint32_t lineNumber, instruction* ins) {
+    instruction_text text;
+    tokenizeInstruction(line, &text);
+    if (!parseInstruction(st, &text, ins)) {
+        fprintf(stderr, "Unknown instruction (%s) on line %u.\n", text.opcode, lineNumber);
+        assemblyError();
+    }
+}
+
+// Tokenizes, parses and encodes one trimmed instruction line placed at address into words.
+// Returns the number of words; exits on an unknown mnemonic.
+uint8_t assembleLine(symbol_table* st, char* line, uint32_t lineNumber, uint32_t address, uint32_t* words) {
+    instruction ins;
+    parseLine(st, line, lineNumber, &ins);
+    return encodeWords(st, &ins, address, words);
+}
+
+// Returns whether a scanned line that is neither blank nor a label may take more than one word: a data
+// directive or a pseudo-instruction (mov/orr with an immediate, or ldr with =). Other lines always take one.
+bool mayTakeSeveralWords(line_scan* line) {
+    char* start = line->start + line->first;
+    size_t length = line->last - line->first;
+    if (line->equals || (*start == '.' && isDataText(start, length))) {
+        return true;
+    }
+    return line->hash && length > 4 && (strncmp(start, "mov", 3) == 0 || strncmp(start, "orr", 3) == 0)
+        && isspace((unsigned char) start[3]);
+}
+
+// Returns the number of words a trimmed instruction or data directive line assembles to.
+// Instructions are tokenized in place, and literal pool entries they need are added to the symbol table.
+uint32_t lineSize(symbol_table* st, char* line, uint32_t lineNumber) {
+    if (isDataDirective(line)) {
+        return dataSize(line, lineNumber);
+    }
+    instruction ins;
+    parseLine(st, line, lineNumber, &ins);
+    return instructionSize(&ins);
+}
+
+/*
+Mnemonic Table
+*/
+
+// Slots come from the perfect hash generated over the ISA tables; unused slots are empty.
+#define ISA_ENTRY(mnemonic, name, ...) [MNEMONIC_SLOT_##name] = {mnemonic, OP_##name, NO_ZERO_REGISTER},
+#define ISA_ALIAS(mnemonic, name, target, rewrite) [MNEMONIC_SLOT_##name] = {mnemonic, OP_##target, rewrite},
+static const mnemonic_entry mnemonicTable[NUM_INSTRUCTION_HASHES] = {
+    ISA_INSTRUCTIONS(ISA_ENTRY)
+    ISA_ALIASES(ISA_ALIAS)
+};
+#undef ISA_ENTRY
+#undef ISA_ALIAS
+
+static const uint16_t mnemonicDisplacements[NUM_MNEMONIC_BUCKETS] = MNEMONIC_DISPLACEMENTS;
+
+// Returns the table entry for a mnemonic, or NULL if the mnemonic is unknown.
+const mnemonic_entry* lookupMnemonic(char* mnemonic) {
+    uint32_t slot = mnemonicSlot(mnemonic, mnemonicDisplacements, NUM_MNEMONIC_BUCKETS, NUM_INSTRUCTION_HASHES);
+    const mnemonic_entry* entry = &mnemonicTable[slot];
+
+    // Every string hashes to some slot, so check it is the mnemonic stored there.
+    if (entry->mnemonic == NULL || strcmp(entry->mnemonic, mnemonic) != 0) {
+        return NULL;
+    }
+    return entry;
+}
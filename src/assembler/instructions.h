@@ -0,0 +1,47 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "defs.h"
+#include "source.h"
+
+// Encodes a parsed instruction at address, given the fixed bits of its mnemonic.
+typedef uint32_t (*encoder)(symbol_table* st, instruction* ins, uint32_t address, uint32_t bits);
+
+// Operand position at which ISA_ALIASES insert the zero register.
+#define ISA_ZR_RD 0
+#define ISA_ZR_RN 1
+#define ISA_ZR_RA 3
+
+// Mnemonic table entry; aliases name their target's opcode.
+typedef struct {
+    const char* mnemonic;
+    uint8_t opcode;
+    int8_t zeroRegister; // position to insert the zero register, or NO_ZERO_REGISTER
+} mnemonic_entry;
+
+// Returns the table entry for a mnemonic, or NULL if the mnemonic is unknown.
+const mnemonic_entry* lookupMnemonic(char* mnemonic);
+
+// Encodes a parsed instruction into its word.
+uint32_t encodeInstruction(symbol_table* st, instruction* ins, uint32_t address);
+
+// Number of words in the shortest movz/movn + movk sequence that loads value into a register.
+uint8_t constantLength(uint64_t value, bool is64);
+
+// Number of words a parsed instruction assembles to.
+uint8_t instructionSize(instruction* ins);
+
+// Encodes a parsed instruction, which may be a pseudo-instruction, into words. Returns their number.
+uint8_t encodeWords(symbol_table* st, instruction* ins, uint32_t address, uint32_t* words);
+
+// Tokenizes, parses and encodes one trimmed instruction line placed at address into words.
+// Returns the number of words; exits on an unknown mnemonic.
+uint8_t assembleLine(symbol_table* st, char* line, uint32_t lineNumber, uint32_t address, uint32_t* words);
+
+// Returns whether a scanned line that is neither blank nor a label may take more than one word: a data
+// directive or a pseudo-instruction (mov/orr with an immediate, or ldr with =). Other lines always take one.
+bool mayTakeSeveralWords(line_scan* line);
+
+// Returns the number of words a trimmed instruction or data directive line assembles to.
+// Instructions are tokenized in place, and literal pool entries they need are added to the symbol table.
+uint32_t lineSize(symbol_table* st, char* line, uint32_t lineNumber);
@@ -0,0 +1,138 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "lexer.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+// Set to "scalar" or "sse2" to use a narrower classifier than the CPU allows (lexer_check compares them).
+#define LEXER_ENV "ASSEMBLE_LEXER"
+
+// Classifies a whole block; every byte of it may be read.
+typedef void (*classifier)(const char* block, char_masks* masks);
+
+/*
+Scalar
+*/
+
+static void classifyScalar(const char* block, char_masks* masks) {
+    memset(masks, 0, sizeof(char_masks));
+    for (int i = 0; i < LEX_BLOCK_SIZE; i++) {
+        uint64_t bit = (uint64_t) 1 << i;
+        switch (block[i]) {
+            case '\n': masks->newline |= bit; masks->space |= bit; break;
+            case ' ': case '\t': case '\v': case '\f': case '\r': masks->space |= bit; break;
+            case ',': masks->comma |= bit; break;
+            case '[': masks->open |= bit; break;
+            case ']': masks->close |= bit; break;
+            case ':': masks->colon |= bit; break;
+            case '#': masks->hash |= bit; break;
+            case '=': masks->equals |= bit; break;
+            default: break;
+        }
+    }
+}
+
+#if defined(__x86_64__)
+
+/*
+SSE2 (every x86-64 CPU has it)
+*/
+
+// Bits of the bytes of x equal to c.
+#define SSE2_MATCH(x, c) ((uint64_t) (uint16_t) _mm_movemask_epi8(_mm_cmpeq_epi8((x), _mm_set1_epi8(c))))
+
+// Bits of the bytes of x that are whitespace: a space, or \t \n \v \f \r (9 to 13).
+static uint64_t sse2Space(__m128i x) {
+    __m128i controls = _mm_sub_epi8(x, _mm_set1_epi8('\t'));
+    __m128i inRange = _mm_cmpeq_epi8(_mm_min_epu8(controls, _mm_set1_epi8('\r' - '\t')), controls);
+    __m128i space = _mm_or_si128(inRange, _mm_cmpeq_epi8(x, _mm_set1_epi8(' ')));
+    return (uint16_t) _mm_movemask_epi8(space);
+}
+
+static void classifySse2(const char* block, char_masks* masks) {
+    memset(masks, 0, sizeof(char_masks));
+    for (int i = 0; i < LEX_BLOCK_SIZE; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*) (block + i));
+        masks->newline |= SSE2_MATCH(x, '\n') << i;
+        masks->space |= sse2Space(x) << i;
+        masks->comma |= SSE2_MATCH(x, ',') << i;
+        masks->open |= SSE2_MATCH(x, '[') << i;
+        masks->close |= SSE2_MATCH(x, ']') << i;
+        masks->colon |= SSE2_MATCH(x, ':') << i;
+        masks->hash |= SSE2_MATCH(x, '#') << i;
+        masks->equals |= SSE2_MATCH(x, '=') << i;
+    }
+}
+
+/*
+AVX2, compiled for that target alone and only run when the CPU reports it
+*/
+
+#define AVX2_MATCH(x, c) ((uint64_t) (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8((x), _mm256_set1_epi8(c))))
+
+__attribute__((target("avx2")))
+static uint64_t avx2Space(__m256i x) {
+    __m256i controls = _mm256_sub_epi8(x, _mm256_set1_epi8('\t'));
+    __m256i inRange = _mm256_cmpeq_epi8(_mm256_min_epu8(controls, _mm256_set1_epi8('\r' - '\t')), controls);
+    __m256i space = _mm256_or_si256(inRange, _mm256_cmpeq_epi8(x, _mm256_set1_epi8(' ')));
+    return (uint32_t) _mm256_movemask_epi8(space);
+}
+
+__attribute__((target("avx2")))
+static void classifyAvx2(const char* block, char_masks* masks) {
+    __m256i low = _mm256_loadu_si256((const __m256i*) block);
+    __m256i high = _mm256_loadu_si256((const __m256i*) (block + 32));
+    masks->newline = AVX2_MATCH(low, '\n') | AVX2_MATCH(high, '\n') << 32;
+    masks->space = avx2Space(low) | avx2Space(high) << 32;
+    masks->comma = AVX2_MATCH(low, ',') | AVX2_MATCH(high, ',') << 32;
+    masks->open = AVX2_MATCH(low, '[') | AVX2_MATCH(high, '[') << 32;
+    masks->close = AVX2_MATCH(low, ']') | AVX2_MATCH(high, ']') << 32;
+    masks->colon = AVX2_MATCH(low, ':') | AVX2_MATCH(high, ':') << 32;
+    masks->hash = AVX2_MATCH(low, '#') | AVX2_MATCH(high, '#') << 32;
+    masks->equals = AVX2_MATCH(low, '=') | AVX2_MATCH(high, '=') << 32;
+}
+
+#endif
+
+/*
+Dispatch
+*/
+
+static classifier classify;
+static pthread_once_t chooseOnce = PTHREAD_ONCE_INIT;
+
+// Picks the widest classifier the CPU supports, unless LEXER_ENV asks for a narrower one.
+static void chooseClassifier(void) {
+    const char* wanted = getenv(LEXER_ENV);
+    classify = classifyScalar;
+    if (wanted != NULL && strcmp(wanted, "scalar") == 0) {
+        return;
+    }
+#if defined(__x86_64__)
+    classify = classifySse2;
+    if (wanted != NULL && strcmp(wanted, "sse2") == 0) {
+        return;
+    }
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        classify = classifyAvx2;
+    }
+#endif
+}
+
+// Classifies the first length (at most LEX_BLOCK_SIZE) bytes of text. Bytes past length are in no class.
+void classifyBlock(const char* text, size_t length, char_masks* masks) {
+    pthread_once(&chooseOnce, chooseClassifier);
+    if (length >= LEX_BLOCK_SIZE) {
+        classify(text, masks);
+        return;
+    }
+    // A short block is padded with NULs, which are in no class, so nothing past text is read.
+    char block[LEX_BLOCK_SIZE] = {0};
+    memcpy(block, text, length);
+    classify(block, masks);
+}
@@ -0,0 +1,26 @@
+#ifndef LEXER_H
+#define LEXER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Bytes classified at a time. Each class is a mask with bit i set when byte i of the block is in it.
+#define LEX_BLOCK_SIZE 64
+
+// The characters the assembler splits lines on, found in one block of text.
+typedef struct {
+    uint64_t newline;
+    uint64_t space;  // anything isspace accepts, newlines included
+    uint64_t comma;
+    uint64_t open;   // [
+    uint64_t close;  // ]
+    uint64_t colon;
+    uint64_t hash;
+    uint64_t equals;
+} char_masks;
+
+// Classifies the first length (at most LEX_BLOCK_SIZE) bytes of text. Bytes past length are in no class.
+// Uses AVX2 or SSE2 compares when the CPU has them and a byte loop otherwise.
+void classifyBlock(const char* text, size_t length, char_masks* masks);
+
+#endif
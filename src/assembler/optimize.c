@@ -0,0 +1,217 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include "defs.h"
+#include "symbol_table.h"
+#include "instructions.h"
+#include "source.h"
+#include "output.h"
+#include "program.h"
+#include "optimize.h"
+
+#define HALFWORD_BITS 16
+#define MAX_THREAD_HOPS 64 // longer chains of branches are assumed to be loops
+
+// Returns whether ins is a branch that only changes the PC (so branching to the next instruction does nothing).
+static bool isPlainBranch(instruction* ins) {
+    return isPcRelative(ins) && ins->opcode != OP_bl && ins->opcode != OP_ldr;
+}
+
+// Returns whether ins is "mov rd, rm": orr with the zero register and no shift.
+static bool isMov(instruction* ins) {
+    return ins->opcode == OP_orr && ins->numOperands == 3 && ins->operands[1].reg == ZR_INDEX
+        && ins->operands[2].kind == OPERAND_REGISTER;
+}
+
+// Returns the halfword a movz or movk writes.
+static int halfwordOf(instruction* ins) {
+    operand* shift = &ins->operands[2];
+    return shift->kind == OPERAND_SHIFT ? shift->imm / HALFWORD_BITS : 0;
+}
+
+// Returns the first instruction at or after index that is kept, or p->size.
+static uint32_t firstKept(program* p, uint32_t index) {
+    while (index < p->size && p->deleted[index]) {
+        index++;
+    }
+    return index;
+}
+
+// Returns the kept instruction a label operand leads to, or NO_INDEX if the label is undefined.
+static uint32_t targetIndex(program* p, operand* target) {
+    uint32_t index = p->labelIndex[target->symbol];
+    return index == NO_INDEX ? NO_INDEX : firstKept(p, index);
+}
+
+// Removes branches to the next instruction and redirects branches whose target is an unconditional branch.
+static bool optimizeBranches(program* p) {
+    bool changed = false;
+    for (uint32_t i = 0; i < p->size; i++) {
+        instruction* ins = &p->instructions[i];
+        if (p->deleted[i] || !isPlainBranch(ins)) {
+            continue;
+        }
+        operand* target = targetOf(ins);
+        uint32_t original = target->symbol;
+
+        // Follow chains of "b" to their end. A chain that loops is left alone.
+        uint32_t hops = 0;
+        for (; hops < MAX_THREAD_HOPS; hops++) {
+            uint32_t j = targetIndex(p, target);
+            if (j == NO_INDEX || j == p->size || j == i || p->instructions[j].opcode != OP_b
+                    || p->instructions[j].operands[0].symbol == target->symbol) {
+                break;
+            }
+            target->symbol = p->instructions[j].operands[0].symbol;
+        }
+        if (hops == MAX_THREAD_HOPS) {
+            target->symbol = original;
+        }
+        changed |= target->symbol != original;
+
+        if (targetIndex(p, target) == firstKept(p, i + 1)) {
+            p->deleted[i] = true;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+// Removes nops, redundant movs and movks that write zero to a halfword that is already zero.
+// Pairs of instructions are only combined when no label points between them.
+static void optimizeMoves(program* p) {
+    int zeroRegister = -1; // register whose value a movz/movk sequence is building, if any
+    bool zeroIs64 = false;
+    uint32_t zeroHalfwords = 0; // halfwords of it known to be zero
+
+    for (uint32_t i = 0; i < p->size; i++) {
+        instruction* ins = &p->instructions[i];
+        if (p->labelled[i]) {
+            zeroRegister = -1;
+        }
+        if (p->deleted[i]) {
+            continue;
+        }
+
+        if (ins->opcode == OP_nop) {
+            p->deleted[i] = true;
+            continue;
+        }
+
+        // movz leaves every other halfword zero; movk #0 into one of those changes nothing.
+        operand* rd = &ins->operands[0];
+        if (ins->opcode == OP_movk && rd->reg == zeroRegister && rd->is64 == zeroIs64) {
+            if (ins->operands[1].imm == 0 && (zeroHalfwords >> halfwordOf(ins) & 1)) {
+                p->deleted[i] = true;
+            } else {
+                zeroHalfwords &= ~(1u << halfwordOf(ins));
+            }
+            continue;
+        }
+        zeroRegister = -1;
+        if (ins->opcode == OP_movz && rd->reg != ZR_INDEX) {
+            zeroRegister = rd->reg;
+            zeroIs64 = rd->is64;
+            zeroHalfwords = (rd->is64 ? 0xf : 0x3) & ~(1u << halfwordOf(ins));
+            continue;
+        }
+
+        if (!isMov(ins) || ins->operands[0].reg == ZR_INDEX) {
+            continue;
+        }
+        uint8_t to = ins->operands[0].reg;
+        uint8_t from = ins->operands[2].reg;
+
+        // "mov xd, xd" does nothing (the 32-bit form clears the top half).
+        if (to == from && ins->operands[0].is64) {
+            p->deleted[i] = true;
+            continue;
+        }
+
+        uint32_t n = i + 1;
+        if (n >= p->size || p->labelled[n] || !isMov(&p->instructions[n])) {
+            continue;
+        }
+        instruction* next = &p->instructions[n];
+        uint8_t nextTo = next->operands[0].reg;
+        uint8_t nextFrom = next->operands[2].reg;
+
+        if (nextTo == to && nextFrom != to) {
+            // The second mov overwrites the first before anything reads it.
+            p->deleted[i] = true;
+        } else if (nextTo == from && nextFrom == to && ins->operands[0].is64 && next->operands[0].is64) {
+            // Copying the value back: the source already holds it.
+            p->deleted[n] = true;
+        } else if (nextFrom == to && ins->operands[0].is64 == next->operands[0].is64) {
+            // Copy from the original register, so the second mov no longer waits for the first.
+            next->operands[2].reg = from;
+        }
+    }
+}
+
+// Assembles src into out after removing or threading redundant instructions. Every label is placed
+// at the instruction it preceded, or the next one kept. Programs with numeric branch or literal
+// offsets, or with register branches, are assembled unchanged, since moving code would break them.
+void assembleOptimized(symbol_table* st, source* src, output* out) {
+    program p;
+    readProgram(st, src, &p);
+
+    bool safe = true;
+    for (uint32_t i = 0; i < p.size; i++) {
+        instruction* ins = &p.instructions[i];
+        if ((isPcRelative(ins) && targetOf(ins)->kind != OPERAND_LABEL) || ins->opcode == OP_br) {
+            safe = false;
+        }
+    }
+
+    if (safe) {
+        optimizeMoves(&p);
+        while (optimizeBranches(&p)) {
+        }
+    } else {
+        fprintf(stderr, "assemble: -O skipped: the program uses numeric offsets or register branches.\n");
+    }
+
+    // Place labels at the new addresses of their instructions and the literal pool after them,
+    // then encode what is left.
+    uint32_t* address = malloc((p.size + 1) * sizeof(uint32_t));
+    assert(address != NULL);
+    uint32_t next = 0;
+    for (uint32_t i = 0; i <= p.size; i++) {
+        address[i] = next;
+        if (i < p.size && !p.deleted[i]) {
+            next += sizeOf(&p.instructions[i]) * INSTRUCTION_SIZE;
+        }
+    }
+    for (uint32_t id = 0; id < st->size; id++) {
+        if (p.labelIndex[id] != NO_INDEX) {
+            addSymbol(st, address[p.labelIndex[id]], st->symbols[id].label, out);
+        }
+    }
+    definePool(st, address[p.size], out);
+    checkUndefinedLabels(st);
+
+    uint32_t words[MAX_INSTRUCTION_WORDS];
+    for (uint32_t i = 0; i < p.size; i++) {
+        instruction* ins = &p.instructions[i];
+        if (p.deleted[i]) {
+            continue;
+        }
+        if (ins->opcode == OP_data) {
+            uint32_t size = sizeOf(ins);
+            memcpy(reserveWords(out, size), &p.data->words[ins->operands[0].imm], size * sizeof(uint32_t));
+            continue;
+        }
+        uint8_t n = encodeWords(st, ins, outputAddress(out), words);
+        for (uint8_t w = 0; w < n; w++) {
+            emitWord(out, words[w]);
+        }
+    }
+    emitPool(st, out);
+
+    free(address);
+    freeProgram(&p);
+}
@@ -0,0 +1,7 @@
+#include "defs.h"
+#include "source.h"
+
+// Assembles src into out after removing or threading redundant instructions. Every label is placed
+// at the instruction it preceded, or the next one kept. Programs with numeric branch or literal
+// offsets, or with register branches, are assembled unchanged, since moving code would break them.
+void assembleOptimized(symbol_table* st, source* src, output* out);
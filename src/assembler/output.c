@@ -0,0 +1,66 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+#include "defs.h"
+#include "output.h"
+
+// Creates an empty output buffer.
+output* newOutput(void) {
+    output* out = malloc(sizeof(output));
+    assert(out != NULL);
+    out->capacity = INITIAL_OUTPUT_CAPACITY;
+    out->words = malloc(out->capacity * sizeof(uint32_t));
+    assert(out->words != NULL);
+    out->size = 0;
+    return out;
+}
+
+// Address the next emitted word will have.
+uint32_t outputAddress(output* out) {
+    return out->size * INSTRUCTION_SIZE;
+}
+
+// Appends a word, growing the buffer as needed.
+void emitWord(output* out, uint32_t word) {
+    if (out->size == out->capacity) {
+        out->capacity *= 2;
+        out->words = realloc(out->words, out->capacity * sizeof(uint32_t));
+        assert(out->words != NULL);
+    }
+    out->words[out->size++] = word;
+}
+
+// Appends n words to be written in place, growing the buffer as needed. Returns the first of them.
+uint32_t* reserveWords(output* out, uint32_t n) {
+    if (out->size + n > out->capacity) {
+        while (out->size + n > out->capacity) {
+            out->capacity *= 2;
+        }
+        out->words = realloc(out->words, out->capacity * sizeof(uint32_t));
+        assert(out->words != NULL);
+    }
+    out->size += n;
+    return &out->words[out->size - n];
+}
+
+// Makes room for n words, which are then written in place rather than emitted.
+void setOutputSize(output* out, uint32_t n) {
+    if (n > out->capacity) {
+        out->capacity = n;
+        out->words = realloc(out->words, out->capacity * sizeof(uint32_t));
+        assert(out->words != NULL);
+    }
+    out->size = n;
+}
+
+// ORs bits into the already emitted word at address.
+void patchWord(output* out, uint32_t address, uint32_t bits) {
+    assert(address / INSTRUCTION_SIZE < out->size);
+    out->words[address / INSTRUCTION_SIZE] |= bits;
+}
+
+// Frees the buffer.
+void freeOutput(output* out) {
+    free(out->words);
+    free(out);
+}
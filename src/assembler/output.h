@@ -0,0 +1,23 @@
+#include <stdint.h>
+#include "defs.h"
+
+// Creates an empty output buffer.
+output* newOutput(void);
+
+// Address the next emitted word will have.
+uint32_t outputAddress(output* out);
+
+// Appends a word, growing the buffer as needed.
+void emitWord(output* out, uint32_t word);
+
+// Appends n words to be written in place, growing the buffer as needed. Returns the first of them.
+uint32_t* reserveWords(output* out, uint32_t n);
+
+// Makes room for n words, which are then written in place rather than emitted.
+void setOutputSize(output* out, uint32_t n);
+
+// ORs bits into the already emitted word at address.
+void patchWord(output* out, uint32_t address, uint32_t bits);
+
+// Frees the buffer.
+void freeOutput(output* out);
@@ -0,0 +1,158 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include "defs.h"
+#include "utils.h"
+#include "symbol_table.h"
+#include "instructions.h"
+#include "directives.h"
+#include "source.h"
+#include "output.h"
+#include "parallel.h"
+
+#define CHECKPOINT_INTERVAL 4096 // words between places a worker may start
+
+// Place in the source where the instruction with the given index starts.
+typedef struct {
+    size_t position;
+    uint32_t lineNumber; // lines before it
+    uint32_t index;
+} checkpoint;
+
+// Run of words [first, last) encoded by one worker.
+typedef struct {
+    symbol_table* st;
+    source* src;
+    uint32_t first;
+    uint32_t last;
+    output* out;
+    pthread_t thread;
+} chunk;
+
+// First pass: defines every label and records a checkpoint at the first line at least
+// CHECKPOINT_INTERVAL words after the previous one.
+// Lines are only copied when they hold a label or may take several words (data directives and
+// pseudo-instructions, which may also need a literal pool entry). Returns the number of checkpoints.
+static uint32_t collectLabels(symbol_table* st, source* src, output* out, checkpoint** checkpoints, uint32_t* numInstructions) {
+    uint32_t capacity = 16;
+    uint32_t numCheckpoints = 0;
+    *checkpoints = malloc(capacity * sizeof(checkpoint));
+    assert(*checkpoints != NULL);
+
+    uint32_t index = 0;
+    uint32_t nextCheckpoint = 0;
+    size_t position = src->position;
+    uint32_t lineNumber = src->lineNumber;
+    line_scan scan;
+    while (scanLine(src, &scan)) {
+        if (scan.colon) {
+            copyScanned(src, &scan);
+            defineLabel(st, src->line, index * INSTRUCTION_SIZE, out);
+        } else if (!isBlankScan(&scan)) {
+            if (index >= nextCheckpoint) {
+                if (numCheckpoints == capacity) {
+                    capacity *= 2;
+                    *checkpoints = realloc(*checkpoints, capacity * sizeof(checkpoint));
+                    assert(*checkpoints != NULL);
+                }
+                checkpoint* c = &(*checkpoints)[numCheckpoints++];
+                c->position = position;
+                c->lineNumber = lineNumber;
+                c->index = index;
+                nextCheckpoint = index + CHECKPOINT_INTERVAL;
+            }
+            if (mayTakeSeveralWords(&scan)) {
+                copyScanned(src, &scan);
+                index += lineSize(st, src->line, src->lineNumber);
+            } else {
+                index++;
+            }
+        }
+        position = src->position;
+        lineNumber = src->lineNumber;
+    }
+
+    *numInstructions = index;
+    return numCheckpoints;
+}
+
+// Encodes the chunk's instructions straight into their slots of the output.
+static void* assembleChunk(void* arg) {
+    chunk* c = arg;
+    uint32_t index = c->first;
+    uint32_t words[MAX_INSTRUCTION_WORDS];
+    line_scan scan;
+
+    while (index < c->last && scanLine(c->src, &scan)) {
+        if (scan.colon || isBlankScan(&scan)) {
+            continue;
+        }
+        copyScanned(c->src, &scan);
+        char* line = c->src->line;
+        if (isDataDirective(line)) {
+            uint32_t size = dataSize(line, c->src->lineNumber);
+            writeData(line, c->src->lineNumber, &c->out->words[index], size);
+            index += size;
+            continue;
+        }
+        uint8_t n = assembleLine(c->st, line, c->src->lineNumber, index * INSTRUCTION_SIZE, words);
+        memcpy(&c->out->words[index], words, n * sizeof(uint32_t));
+        index += n;
+    }
+    return NULL;
+}
+
+// Assembles src into out with numThreads worker threads. Labels are collected in one pass over
+// the line boundaries, then each thread encodes a contiguous run of instructions in place.
+void assembleParallel(symbol_table* st, source* src, output* out, int numThreads) {
+    checkpoint* checkpoints;
+    uint32_t numInstructions;
+    uint32_t numCheckpoints = collectLabels(st, src, out, &checkpoints, &numInstructions);
+
+    // Every pool entry was found while sizing the lines, so the pool can be laid out before the code.
+    definePool(st, numInstructions * INSTRUCTION_SIZE, out);
+    setOutputSize(out, numInstructions);
+    emitPool(st, out);
+
+    // Only labels and blank lines: there is nothing for a worker to encode.
+    if (numCheckpoints == 0) {
+        free(checkpoints);
+        return;
+    }
+
+    // Every label is defined now; workers only read the table.
+    st->frozen = true;
+
+    // Spread the checkpoints evenly over the workers.
+    if ((uint32_t) numThreads > numCheckpoints) {
+        numThreads = numCheckpoints;
+    }
+    chunk* chunks = malloc(numThreads * sizeof(chunk));
+    assert(chunks != NULL);
+    for (int t = 0; t < numThreads; t++) {
+        checkpoint* from = &checkpoints[(uint64_t) numCheckpoints * t / numThreads];
+        uint32_t next = (uint64_t) numCheckpoints * (t + 1) / numThreads;
+
+        chunks[t].st = st;
+        chunks[t].src = sourceFrom(src, from->position, from->lineNumber);
+        chunks[t].first = from->index;
+        chunks[t].last = next < numCheckpoints ? checkpoints[next].index : numInstructions;
+        chunks[t].out = out;
+        if (pthread_create(&chunks[t].thread, NULL, assembleChunk, &chunks[t]) != 0) {
+            fprintf(stderr, "assemble: cannot start worker thread.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    for (int t = 0; t < numThreads; t++) {
+        pthread_join(chunks[t].thread, NULL);
+        closeSource(chunks[t].src);
+    }
+    free(chunks);
+    free(checkpoints);
+    st->frozen = false;
+}
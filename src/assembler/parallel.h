@@ -0,0 +1,6 @@
+#include "defs.h"
+#include "source.h"
+
+// Assembles src into out with numThreads worker threads. Labels are collected in one pass over
+// the line boundaries, then each thread encodes a contiguous run of instructions in place.
+void assembleParallel(symbol_table* st, source* src, output* out, int numThreads);
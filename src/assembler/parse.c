@@ -0,0 +1,212 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include "defs.h"
+#include "symbol_table.h"
+#include "instructions.h"
+#include "parse.h"
+#include "utils.h"
+
+#define SHIFT_NAME_LEN 3
+#define MAX_REGISTER 30
+
+// Shift names indexed by their ISA_SHIFT_* encoding.
+static const char* shiftNames[] = {"lsl", "lsr", "asr", "ror"};
+
+// Parses a general purpose register (x0-x30, w0-w30, xzr or wzr). Returns false if text is not one.
+static bool parseRegister(char* text, operand* op) {
+    if (text[0] != 'x' && text[0] != 'w') {
+        return false;
+    }
+
+    uint8_t reg = ZR_INDEX;
+    if (strcmp(text + 1, "zr") != 0) {
+        // Anything other than a register number (e.g. "wait") is a label.
+        char* end;
+        unsigned long n = strtoul(text + 1, &end, DENARY_BASE);
+        if (!isdigit((unsigned char) text[1]) || *end != '\0' || n > MAX_REGISTER) {
+            return false;
+        }
+        reg = n;
+    }
+
+    op->kind = OPERAND_REGISTER;
+    op->reg = reg;
+    op->is64 = text[0] == 'x';
+    return true;
+}
+
+// Parses a decimal or 0x-prefixed hexadecimal number, optionally negative and prefixed with #.
+static int64_t parseNumber(char* text) {
+    if (*text == '#') {
+        text++;
+    }
+    bool negative = *text == '-';
+    if (negative) {
+        text++;
+    }
+
+    uint64_t value;
+    if (strncmp(text, "0x", 2) == 0) {
+        value = strtoull(text, NULL, HEX_BASE);
+    } else {
+        value = strtoull(text, NULL, DENARY_BASE);
+    }
+    return negative ? -(int64_t) value : (int64_t) value;
+}
+
+// Parses "[xn]", "[xn,#imm]", "[xn,#imm]!" or "[xn,xm]"; post-indexing is recognised by parseInstruction.
+static void parseAddress(char* text, operand* op) {
+    op->kind = OPERAND_ADDRESS;
+    op->mode = ADDRESS_OFFSET;
+    op->imm = 0;
+
+    // Split in place into the base register and optional offset
+    char* base = text + 1;
+    char* close = strchr(base, ']');
+    if (close == NULL) {
+        fprintf(stderr, "Invalid address (%s).\n", text);
+        assemblyError();
+    }
+    if (close[1] == '!') {
+        op->mode = ADDRESS_PRE_INDEX;
+    }
+    *close = '\0';
+    char* offset = strchr(base, ',');
+    if (offset != NULL) {
+        *offset++ = '\0';
+    }
+
+    operand reg;
+    if (!parseRegister(base, &reg)) {
+        fprintf(stderr, "Invalid base register (%s).\n", base);
+        assemblyError();
+    }
+    op->reg = reg.reg;
+
+    if (offset == NULL) {
+        return;
+    }
+    if (parseRegister(offset, &reg)) {
+        op->mode = ADDRESS_REGISTER;
+        op->index = reg.reg;
+    } else if (*offset == '#') {
+        op->imm = parseNumber(offset);
+    } else {
+        fprintf(stderr, "Invalid address offset (%s).\n", offset);
+        assemblyError();
+    }
+}
+
+// Parses a shift such as "lsl#12" (whitespace is already removed). Returns false if text is not one.
+static bool parseShift(char* text, operand* op) {
+    for (uint8_t shift = 0; shift < sizeof(shiftNames) / sizeof(shiftNames[0]); shift++) {
+        if (strncmp(text, shiftNames[shift], SHIFT_NAME_LEN) == 0 && text[SHIFT_NAME_LEN] == '#') {
+            op->kind = OPERAND_SHIFT;
+            op->shift = shift;
+            op->imm = parseNumber(text + SHIFT_NAME_LEN);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Classifies and parses one operand. Anything that is not a register, number, shift, address or
+// "=constant" is a label.
+static void parseOperand(symbol_table* st, char* text, operand* op) {
+    memset(op, 0, sizeof(operand));
+
+    if (*text == '[') {
+        parseAddress(text, op);
+    } else if (*text == '=') {
+        op->kind = OPERAND_CONSTANT;
+        op->imm = parseNumber(text + 1);
+    } else if (*text == '#' || isdigit((unsigned char) *text) || (*text == '-' && isdigit((unsigned char) text[1]))) {
+        op->kind = OPERAND_IMMEDIATE;
+        op->imm = parseNumber(text);
+    } else if (parseRegister(text, op) || parseShift(text, op)) {
+        return;
+    } else {
+        op->kind = OPERAND_LABEL;
+        op->symbol = symbolId(st, text);
+    }
+}
+
+// Turns "mov rd, #imm" (orr rd, zr, #imm) and "ldr rd, =imm" into the constant pseudo-instruction.
+// A 64-bit ldr whose value would take more than two wide moves loads it from the literal pool instead.
+static void parseConstant(symbol_table* st, instruction* ins) {
+    operand* rd = &ins->operands[0];
+    operand* value = &ins->operands[1];
+    if (ins->opcode == OP_orr && ins->numOperands == 3 && value->kind == OPERAND_REGISTER
+            && value->reg == ZR_INDEX && ins->operands[2].kind == OPERAND_IMMEDIATE) {
+        *value = ins->operands[2];
+    } else if (ins->opcode == OP_ldr && ins->numOperands == 2 && value->kind == OPERAND_CONSTANT) {
+        if (rd->is64 && constantLength(value->imm, true) > 2) {
+            value->kind = OPERAND_LABEL;
+            value->symbol = poolSymbol(st, value->imm);
+            return;
+        }
+        value->kind = OPERAND_IMMEDIATE;
+    } else {
+        for (int i = 0; i < ins->numOperands; i++) {
+            if (ins->operands[i].kind == OPERAND_CONSTANT) {
+                fprintf(stderr, "Constant (=%lld) can only be loaded with ldr.\n", (long long) ins->operands[i].imm);
+                assemblyError();
+            }
+        }
+        return;
+    }
+
+    ins->opcode = OP_constant;
+    ins->numOperands = 2;
+    memset(&ins->operands[2], 0, sizeof(operand));
+    if (!rd->is64) {
+        value->imm &= UINT32_MAX;
+    }
+}
+
+// Parses a tokenized line into an instruction. Returns false if the mnemonic is unknown.
+bool parseInstruction(symbol_table* st, instruction_text* text, instruction* ins) {
+    const mnemonic_entry* entry = lookupMnemonic(text->opcode);
+    if (entry == NULL) {
+        return false;
+    }
+    ins->opcode = entry->opcode;
+
+    ins->numOperands = 0;
+    for (int i = 0; i < MAX_OPERANDS && strcmp(text->operands[i], "") != 0; i++) {
+        operand* op = &ins->operands[ins->numOperands++];
+        parseOperand(st, text->operands[i], op);
+
+        // "[xn], #imm" is a single post-indexed address
+        operand* previous = op - 1;
+        if (i > 0 && op->kind == OPERAND_IMMEDIATE && previous->kind == OPERAND_ADDRESS
+                && previous->mode == ADDRESS_OFFSET && previous->imm == 0) {
+            previous->mode = ADDRESS_POST_INDEX;
+            previous->imm = op->imm;
+            ins->numOperands--;
+        }
+    }
+
+    // Aliases insert the zero register (of the first operand's width) and encode as their target
+    if (entry->zeroRegister != NO_ZERO_REGISTER && entry->zeroRegister <= ins->numOperands
+            && ins->numOperands < MAX_OPERANDS) {
+        operand* position = &ins->operands[entry->zeroRegister];
+        memmove(position + 1, position, (ins->numOperands - entry->zeroRegister) * sizeof(operand));
+        memset(position, 0, sizeof(operand));
+        position->kind = OPERAND_REGISTER;
+        position->reg = ZR_INDEX;
+        position->is64 = ins->operands[entry->zeroRegister == 0 ? 1 : 0].is64;
+        ins->numOperands++;
+    }
+
+    // Unused operands read as OPERAND_NONE
+    for (int i = ins->numOperands; i < MAX_OPERANDS; i++) {
+        memset(&ins->operands[i], 0, sizeof(operand));
+    }
+    parseConstant(st, ins);
+    return true;
+}
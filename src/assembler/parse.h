@@ -0,0 +1,5 @@
+#include <stdbool.h>
+#include "defs.h"
+
+// Parses a tokenized line into an instruction. Returns false if the mnemonic is unknown.
+bool parseInstruction(symbol_table* st, instruction_text* text, instruction* ins);
@@ -0,0 +1,37 @@
+#ifndef PERFECT_HASH_H
+#define PERFECT_HASH_H
+
+#include <stdint.h>
+
+// Two-level (hash and displace) perfect hash over the mnemonic set.
+// A mnemonic's first-level hash picks a bucket; the bucket's displacement, chosen by
+// gen_mnemonic_hash at build time, is mixed in to give a slot no other mnemonic uses.
+
+// FNV-1a hash of a mnemonic; both levels are derived from this single pass.
+static inline uint32_t hashMnemonic(const char* t) {
+    uint32_t h = 2166136261u;
+    for (; *t != '\0'; t++) {
+        h = (h ^ (unsigned char) *t) * 16777619u;
+    }
+    return h;
+}
+
+// Mixes a mnemonic hash with its bucket's displacement.
+static inline uint32_t mixMnemonic(uint32_t h, uint32_t displacement) {
+    h ^= displacement * 0x9e3779b9u;
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+// Slot of a mnemonic given the displacement table; numSlots is a power of two.
+static inline uint32_t mnemonicSlot(const char* t, const uint16_t* displacements,
+                                    uint32_t numBuckets, uint32_t numSlots) {
+    uint32_t h = hashMnemonic(t);
+    return mixMnemonic(h, displacements[h % numBuckets]) & (numSlots - 1);
+}
+
+#endif
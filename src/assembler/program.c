@@ -0,0 +1,136 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include "defs.h"
+#include "utils.h"
+#include "symbol_table.h"
+#include "instructions.h"
+#include "directives.h"
+#include "tokenize.h"
+#include "parse.h"
+#include "source.h"
+#include "output.h"
+#include "program.h"
+
+#define INITIAL_PROGRAM_CAPACITY 1024
+
+// Returns whether ins encodes an offset from its own address (branches and literal loads).
+bool isPcRelative(instruction* ins) {
+    switch (ins->opcode) {
+        case OP_b:
+        case OP_bl:
+        case OP_cbz:
+        case OP_cbnz:
+            return true;
+        case OP_ldr:
+            return ins->operands[1].kind != OPERAND_ADDRESS;
+        default:
+            // Conditional branches are listed together in the ISA tables.
+            return ins->opcode >= OP_beq && ins->opcode <= OP_bnv;
+    }
+}
+
+// Returns the operand holding a PC-relative instruction's target.
+operand* targetOf(instruction* ins) {
+    return ins->opcode == OP_cbz || ins->opcode == OP_cbnz || ins->opcode == OP_ldr
+        ? &ins->operands[1] : &ins->operands[0];
+}
+
+// Number of words ins takes.
+uint32_t sizeOf(instruction* ins) {
+    return ins->opcode == OP_data ? ins->operands[1].imm : instructionSize(ins);
+}
+
+// Reads and parses every line of src, recording where labels point.
+void readProgram(symbol_table* st, source* src, program* p) {
+    p->capacity = INITIAL_PROGRAM_CAPACITY;
+    p->size = 0;
+    p->instructions = malloc(p->capacity * sizeof(instruction));
+    p->lines = malloc(p->capacity * sizeof(uint32_t));
+    assert(p->instructions != NULL && p->lines != NULL);
+    p->data = newOutput();
+
+    // Label positions by symbol id; the table may grow while parsing, so they are indexed afterwards.
+    uint32_t numLabels = 0;
+    uint32_t labelCapacity = INITIAL_PROGRAM_CAPACITY;
+    uint32_t (*labels)[2] = malloc(labelCapacity * sizeof(*labels));
+    assert(labels != NULL);
+
+    line_scan scan;
+    while (scanLine(src, &scan)) {
+        if (isBlankScan(&scan)) {
+            continue;
+        }
+        copyScanned(src, &scan);
+        char* line = src->line;
+
+        if (scan.colon) {
+            line[strlen(line) - 1] = '\0';
+            removeWhitespace(line);
+            if (numLabels == labelCapacity) {
+                labelCapacity *= 2;
+                labels = realloc(labels, labelCapacity * sizeof(*labels));
+                assert(labels != NULL);
+            }
+            labels[numLabels][0] = symbolId(st, line);
+            labels[numLabels][1] = p->size;
+            numLabels++;
+        } else {
+            if (p->size == p->capacity) {
+                p->capacity *= 2;
+                p->instructions = realloc(p->instructions, p->capacity * sizeof(instruction));
+                p->lines = realloc(p->lines, p->capacity * sizeof(uint32_t));
+                assert(p->instructions != NULL && p->lines != NULL);
+            }
+            p->lines[p->size] = src->lineNumber;
+            instruction* ins = &p->instructions[p->size];
+            if (isDataDirective(line)) {
+                uint32_t size = dataSize(line, src->lineNumber);
+                memset(ins, 0, sizeof(instruction));
+                ins->opcode = OP_data;
+                ins->operands[0].imm = p->data->size;
+                ins->operands[1].imm = size;
+                writeData(line, src->lineNumber, reserveWords(p->data, size), size);
+                p->size++;
+                continue;
+            }
+            instruction_text text;
+            tokenizeInstruction(line, &text);
+            if (!parseInstruction(st, &text, ins)) {
+                fprintf(stderr, "Unknown instruction (%s) on line %u.\n", text.opcode, src->lineNumber);
+                assemblyError();
+            }
+            p->size++;
+        }
+    }
+
+    p->deleted = calloc(p->size + 1, sizeof(bool));
+    p->labelled = calloc(p->size + 1, sizeof(bool));
+    p->labelIndex = malloc((st->size > 0 ? st->size : 1) * sizeof(uint32_t));
+    assert(p->deleted != NULL && p->labelled != NULL && p->labelIndex != NULL);
+    for (uint32_t id = 0; id < st->size; id++) {
+        p->labelIndex[id] = NO_INDEX;
+    }
+    for (uint32_t i = 0; i < numLabels; i++) {
+        if (p->labelIndex[labels[i][0]] != NO_INDEX) {
+            fprintf(stderr, "Label (%s) defined more than once.\n", st->symbols[labels[i][0]].label);
+            assemblyError();
+        }
+        p->labelIndex[labels[i][0]] = labels[i][1];
+        p->labelled[labels[i][1]] = true;
+    }
+    free(labels);
+}
+
+// Frees what readProgram allocated.
+void freeProgram(program* p) {
+    free(p->instructions);
+    freeOutput(p->data);
+    free(p->deleted);
+    free(p->labelled);
+    free(p->labelIndex);
+    free(p->lines);
+}
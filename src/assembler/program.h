@@ -0,0 +1,40 @@
+#ifndef PROGRAM_H
+#define PROGRAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "defs.h"
+#include "source.h"
+
+#define NO_INDEX UINT32_MAX
+
+// Whole program as parsed instructions, with every label's position among them. Data directives
+// are OP_data entries: the imm of operand 0 is where their words start in data, that of operand 1
+// how many there are.
+typedef struct {
+    instruction* instructions;
+    output* data;
+    bool* deleted;
+    uint32_t size;
+    uint32_t capacity;
+    uint32_t* labelIndex; // by symbol id: index of the instruction the label precedes, or NO_INDEX
+    bool* labelled;       // by instruction: some label points at it
+    uint32_t* lines;      // by instruction: its line in the source
+} program;
+
+// Reads and parses every line of src, recording where labels point.
+void readProgram(symbol_table* st, source* src, program* p);
+
+// Frees what readProgram allocated.
+void freeProgram(program* p);
+
+// Returns whether ins encodes an offset from its own address (branches and literal loads).
+bool isPcRelative(instruction* ins);
+
+// Returns the operand holding a PC-relative instruction's target.
+operand* targetOf(instruction* ins);
+
+// Number of words ins takes.
+uint32_t sizeOf(instruction* ins);
+
+#endif
@@ -0,0 +1,69 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include "defs.h"
+#include "relocatable.h"
+#include "utils.h"
+#include "output.h"
+#include "object.h"
+
+// Number of words needed to hold size bytes.
+static uint32_t wordsFor(size_t size) {
+    return (size + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+}
+
+// Writes out and the labels of st as a relocatable object (see object.h) to path.
+// References to labels st does not define become relocations for link to fill in.
+void writeObject(char* path, symbol_table* st, output* out) {
+    object_header header = {OBJECT_MAGIC, OBJECT_VERSION, out->size, st->size, 0, 0};
+
+    // Symbols keep their ids; every pending fixup belongs to an undefined symbol.
+    for (uint32_t id = 0; id < st->size; id++) {
+        header.stringsSize += strlen(st->symbols[id].label) + 1;
+        for (uint32_t i = st->symbols[id].fixups; i != NO_FIXUP; i = st->fixups[i].next) {
+            header.numRelocations++;
+        }
+    }
+    header.stringsSize = wordsFor(header.stringsSize) * sizeof(uint32_t);
+
+    // The whole object is built in memory so it can go out in a single write.
+    uint32_t size = wordsFor(sizeof(object_header)) + header.numWords
+        + header.numSymbols * wordsFor(sizeof(object_symbol))
+        + header.numRelocations * wordsFor(sizeof(object_relocation))
+        + header.stringsSize / sizeof(uint32_t);
+    uint32_t* object = calloc(size, sizeof(uint32_t));
+    assert(object != NULL);
+
+    char* next = (char*) object;
+    memcpy(next, &header, sizeof(header));
+    next += sizeof(header);
+    memcpy(next, out->words, (size_t) out->size * sizeof(uint32_t));
+    next += (size_t) out->size * sizeof(uint32_t);
+
+    object_symbol* symbols = (object_symbol*) next;
+    object_relocation* relocations = (object_relocation*) (symbols + header.numSymbols);
+    char* strings = (char*) (relocations + header.numRelocations);
+    uint32_t name = 0;
+    uint32_t r = 0;
+    for (uint32_t id = 0; id < st->size; id++) {
+        symbol* sym = &st->symbols[id];
+        symbols[id].name = name;
+        symbols[id].address = sym->address;
+        // Literal pool entries are private to the object; other objects have their own.
+        symbols[id].defined = sym->defined && !sym->pooled;
+        strcpy(strings + name, sym->label);
+        name += strlen(sym->label) + 1;
+
+        for (uint32_t i = sym->fixups; i != NO_FIXUP; i = st->fixups[i].next) {
+            relocations[r].address = st->fixups[i].address;
+            relocations[r].symbol = id;
+            relocations[r].start = st->fixups[i].start;
+            relocations[r].len = st->fixups[i].len;
+            r++;
+        }
+    }
+
+    writeBinary(path, object, size);
+    free(object);
+}
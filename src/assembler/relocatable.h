@@ -0,0 +1,5 @@
+#include "defs.h"
+
+// Writes out and the labels of st as a relocatable object (see object.h) to path.
+// References to labels st does not define become relocations for link to fill in.
+void writeObject(char* path, symbol_table* st, output* out);
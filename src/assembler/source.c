@@ -0,0 +1,214 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "source.h"
+#include "utils.h"
+
+#define SOURCE_CHUNK_SIZE 65536 // read size when the file cannot be mapped
+#define INITIAL_LINE_CAPACITY 128
+
+// Reads all of fd into a growable heap buffer; used for pipes and other unmappable files.
+static void readAll(source* src, int fd) {
+    size_t capacity = SOURCE_CHUNK_SIZE;
+    src->data = malloc(capacity);
+    assert(src->data != NULL);
+    src->size = 0;
+
+    ssize_t got;
+    while ((got = read(fd, src->data + src->size, capacity - src->size)) > 0) {
+        src->size += got;
+        if (src->size == capacity) {
+            capacity *= 2;
+            src->data = realloc(src->data, capacity);
+            assert(src->data != NULL);
+        }
+    }
+    src->mapped = false;
+}
+
+// Opens the source file at path; exits on failure.
+source* openSource(char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "ERROR: Cannot open file: %s\n", path);
+        assemblyError();
+    }
+
+    source* src = malloc(sizeof(source));
+    assert(src != NULL);
+
+    // Regular files are mapped so only the pages being scanned need to be resident.
+    struct stat info;
+    src->mapped = false;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void* data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            madvise(data, info.st_size, MADV_SEQUENTIAL);
+            src->data = data;
+            src->size = info.st_size;
+            src->mapped = true;
+        }
+    }
+    if (!src->mapped) {
+        readAll(src, fd);
+    }
+    close(fd);
+
+    src->borrowed = false;
+    src->lineCapacity = INITIAL_LINE_CAPACITY;
+    src->line = malloc(src->lineCapacity);
+    assert(src->line != NULL);
+    src->position = 0;
+    src->lineNumber = 0;
+    src->maskedBlock = SIZE_MAX;
+    return src;
+}
+
+// Creates a reader over src's contents starting at byte position, as if lineNumber lines had been read.
+source* sourceFrom(source* src, size_t position, uint32_t lineNumber) {
+    source* view = malloc(sizeof(source));
+    assert(view != NULL);
+    *view = *src;
+    view->borrowed = true;
+    view->lineCapacity = INITIAL_LINE_CAPACITY;
+    view->line = malloc(view->lineCapacity);
+    assert(view->line != NULL);
+    view->position = position;
+    view->lineNumber = lineNumber;
+    return view;
+}
+
+// Advances to the next line without copying it; start and length give the line (without newline) in data.
+bool skipLine(source* src, char** start, size_t* length) {
+    if (src->position >= src->size) {
+        return false;
+    }
+
+    *start = src->data + src->position;
+    size_t remaining = src->size - src->position;
+    char* newline = memchr(*start, '\n', remaining);
+    *length = newline != NULL ? (size_t) (newline - *start) : remaining;
+
+    src->position += *length + (newline != NULL);
+    src->lineNumber++;
+    return true;
+}
+
+// Returns the classes of the bytes of the block holding offset, classifying it unless it was the last one.
+// Blocks are aligned to LEX_BLOCK_SIZE within data, so a view made by sourceFrom can keep its source's.
+static char_masks* blockMasks(source* src, size_t offset) {
+    size_t block = offset - offset % LEX_BLOCK_SIZE;
+    if (block != src->maskedBlock) {
+        size_t length = src->size - block;
+        classifyBlock(src->data + block, length < LEX_BLOCK_SIZE ? length : LEX_BLOCK_SIZE, &src->masks);
+        src->maskedBlock = block;
+    }
+    return &src->masks;
+}
+
+// Advances to the next line like skipLine, classifying its characters a block at a time as it goes.
+bool scanLine(source* src, line_scan* line) {
+    if (src->position >= src->size) {
+        return false;
+    }
+
+    size_t start = src->position;
+    size_t offset = start;
+    uint64_t colon = 0;
+    uint64_t equals = 0;
+    uint64_t hash = 0;
+    bool text = false;
+    line->start = src->data + start;
+    line->first = 0;
+    line->last = 0;
+
+    // Masks are shifted so bit 0 is the byte at offset. Bytes past the end of data are in no class.
+    uint64_t newline;
+    do {
+        char_masks* masks = blockMasks(src, offset);
+        unsigned shift = offset % LEX_BLOCK_SIZE;
+        newline = masks->newline >> shift;
+        size_t n = newline != 0 ? (size_t) __builtin_ctzll(newline) : LEX_BLOCK_SIZE - shift;
+        if (n > src->size - offset) {
+            n = src->size - offset;
+        }
+        uint64_t inLine = n == LEX_BLOCK_SIZE ? ~(uint64_t) 0 : ((uint64_t) 1 << n) - 1;
+
+        uint64_t nonSpace = ~(masks->space >> shift) & inLine;
+        if (nonSpace != 0) {
+            if (!text) {
+                line->first = offset - start + __builtin_ctzll(nonSpace);
+                text = true;
+            }
+            line->last = offset - start + LEX_BLOCK_SIZE - __builtin_clzll(nonSpace);
+        }
+        colon |= (masks->colon >> shift) & inLine;
+        equals |= (masks->equals >> shift) & inLine;
+        hash |= (masks->hash >> shift) & inLine;
+        offset += n;
+    } while (newline == 0 && offset < src->size);
+
+    line->length = offset - start;
+    line->colon = colon != 0;
+    line->equals = equals != 0;
+    line->hash = hash != 0;
+    src->position = offset + (newline != 0);
+    src->lineNumber++;
+    return true;
+}
+
+// Returns whether a scanned line holds nothing but whitespace.
+bool isBlankScan(line_scan* line) {
+    return line->first == line->last;
+}
+
+// Copies a scanned line, without leading and trailing whitespace, into src->line.
+void copyScanned(source* src, line_scan* line) {
+    copyLine(src, line->start + line->first, line->last - line->first);
+}
+
+// Copies a line found by skipLine into src->line, growing the buffer if needed.
+void copyLine(source* src, char* start, size_t length) {
+    // Line buffer is reused; it only grows when a longer line turns up.
+    if (length + 1 > src->lineCapacity) {
+        while (length + 1 > src->lineCapacity) {
+            src->lineCapacity *= 2;
+        }
+        src->line = realloc(src->line, src->lineCapacity);
+        assert(src->line != NULL);
+    }
+    memcpy(src->line, start, length);
+    src->line[length] = '\0';
+}
+
+// Advances to the next line, copying it into src->line. Returns false at end of file.
+bool nextLine(source* src) {
+    char* start;
+    size_t length;
+    if (!skipLine(src, &start, &length)) {
+        return false;
+    }
+    copyLine(src, start, length);
+    return true;
+}
+
+// Unmaps or frees the file and line buffer.
+void closeSource(source* src) {
+    // Borrowed contents are released with the source they came from
+    if (!src->borrowed) {
+        if (src->mapped) {
+            munmap(src->data, src->size);
+        } else {
+            free(src->data);
+        }
+    }
+    free(src->line);
+    free(src);
+}
@@ -0,0 +1,61 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "lexer.h"
+
+// Assembly source read line by line from a mapped (or, for pipes, buffered) file.
+typedef struct {
+    char* data;          // whole file contents
+    size_t size;
+    bool mapped;         // data came from mmap rather than the heap
+    bool borrowed;       // data belongs to another source (see sourceFrom)
+    size_t position;     // start of the next line in data
+    char* line;          // current line, NUL terminated and without its newline
+    size_t lineCapacity; // grows to fit the longest line
+    uint32_t lineNumber; // 1-based number of the current line
+    char_masks masks;    // classes of the bytes of the block at maskedBlock
+    size_t maskedBlock;  // offset of the classified block in data, or SIZE_MAX
+} source;
+
+// A line found by scanLine, with what the assembler needs to know about it before copying it.
+typedef struct {
+    char* start;   // the line in data, without its newline
+    size_t length;
+    size_t first;  // the line without leading and trailing whitespace is start[first, last)
+    size_t last;
+    bool colon;    // defines a label
+    bool equals;
+    bool hash;
+} line_scan;
+
+// Opens the source file at path; exits on failure.
+source* openSource(char* path);
+
+// Advances to the next line, copying it into src->line. Returns false at end of file.
+bool nextLine(source* src);
+
+// Advances to the next line without copying it; start and length give the line (without newline) in data.
+bool skipLine(source* src, char** start, size_t* length);
+
+// Advances to the next line like skipLine, classifying its characters a block at a time as it goes.
+bool scanLine(source* src, line_scan* line);
+
+// Returns whether a scanned line holds nothing but whitespace.
+bool isBlankScan(line_scan* line);
+
+// Copies a scanned line, without leading and trailing whitespace, into src->line.
+void copyScanned(source* src, line_scan* line);
+
+// Copies a line found by skipLine into src->line, growing the buffer if needed.
+void copyLine(source* src, char* start, size_t length);
+
+// Creates a reader over src's contents starting at byte position, as if lineNumber lines had been read.
+source* sourceFrom(source* src, size_t position, uint32_t lineNumber);
+
+// Unmaps or frees the file and line buffer.
+void closeSource(source* src);
+
+#endif
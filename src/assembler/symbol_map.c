@@ -0,0 +1,69 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "defs.h"
+#include "utils.h"
+#include "symbol_table.h"
+#include "instructions.h"
+#include "source.h"
+#include "symbol_map.h"
+
+#define POOL_LABEL "=pool" // named like the pool's entries ("=<value>"), which no source label can be referred to as
+
+// Writes the symbol map of the assembled src to path. Each line, in address order, is either
+//   <address> <line> <label>   the label is defined at address, on source line line
+//   <address> <line>           instructions from address on come from consecutive source lines,
+//                              starting with line
+//   <address> <line> *         the words from address on all come from line (a data directive or
+//                              pseudo-instruction that takes several)
+//   <address> 0 =pool          the literal pool after the code starts at address (with its padding)
+//   <address> 0 *              and its words come from no source line
+// Addresses are hex, lines decimal. Labels are looked up in st, so src must have been assembled.
+void writeSymbolMap(source* src, symbol_table* st, char* path) {
+    FILE* map = fopen(path, "w");
+    if (map == NULL) {
+        fprintf(stderr, "Error opening file at %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+
+    src->position = 0;
+    src->lineNumber = 0;
+    uint32_t address = 0;
+    bool inRun = false; // whether the next instruction continues the current run
+    line_scan scan;
+    while (scanLine(src, &scan)) {
+        if (scan.colon) {
+            copyScanned(src, &scan);
+            src->line[strlen(src->line) - 1] = '\0';
+            removeWhitespace(src->line);
+            symbol* sym = &st->symbols[symbolId(st, src->line)];
+            fprintf(map, "%x %u %s\n", sym->address, src->lineNumber, sym->label);
+            inRun = false;
+        } else if (!isBlankScan(&scan)) {
+            uint32_t size = 1;
+            if (mayTakeSeveralWords(&scan)) {
+                copyScanned(src, &scan);
+                size = lineSize(st, src->line, src->lineNumber);
+            }
+            // A run continues as long as one-word instructions sit on consecutive lines.
+            if (size != 1) {
+                fprintf(map, "%x %u *\n", address, src->lineNumber);
+            } else if (!inRun) {
+                fprintf(map, "%x %u\n", address, src->lineNumber);
+            }
+            inRun = size == 1;
+            address += size * INSTRUCTION_SIZE;
+        } else {
+            inRun = false;
+        }
+    }
+    if (st->poolSize > 0) {
+        fprintf(map, "%x 0 " POOL_LABEL "\n%x 0 *\n", address, address);
+    }
+
+    if (fclose(map) != 0) {
+        fprintf(stderr, "Error writing file at %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+}
@@ -0,0 +1,12 @@
+#include "defs.h"
+#include "source.h"
+
+// Writes the symbol map of the assembled src to path. Each line, in address order, is either
+//   <address> <line> <label>   the label is defined at address, on source line line
+//   <address> <line>           instructions from address on come from consecutive source lines,
+//                              starting with line
+//   <address> <line> *         the words from address on all come from line
+//   <address> 0 =pool          the literal pool after the code starts at address
+//   <address> 0 *              and its words come from no source line
+// Addresses are hex, lines decimal. Labels are looked up in st, so src must have been assembled.
+void writeSymbolMap(source* src, symbol_table* st, char* path);
@@ -4,84 +4,281 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
-#include <regex.h>
-#include <ctype.h>
 #include "utils.h"
 #include "defs.h"
+#include "output.h"
+
+// Returns the FNV-1a hash of a label.
+static uint32_t hashLabel(char* label) {
+	uint32_t h = 2166136261u;
+	for (; *label != '\0'; label++) {
+		h = (h ^ (unsigned char) *label) * 16777619u;
+	}
+	return h;
+}
+
+// Copies label into the arena, starting a new block when the current one is full.
+static char* internLabel(symbol_table* st, char* label) {
+	size_t length = strlen(label) + 1;
+	label_block* block = st->arena;
+
+	if (block == NULL || block->capacity - block->used < length) {
+		size_t capacity = length > LABEL_ARENA_BLOCK_SIZE ? length : LABEL_ARENA_BLOCK_SIZE;
+		block = malloc(sizeof(label_block) + capacity);
+		assert(block != NULL);
+		block->next = st->arena;
+		block->used = 0;
+		block->capacity = capacity;
+		st->arena = block;
+	}
+
+	char* interned = block->text + block->used;
+	memcpy(interned, label, length);
+	block->used += length;
+	return interned;
+}
+
+// Returns the slot holding label's id, or the empty slot where it would be inserted.
+static uint32_t* findSlot(symbol_table* st, char* label, uint32_t h) {
+	uint32_t mask = st->capacity - 1;
+	uint32_t i = h & mask;
+
+	// Linear probing; the table is never full so an empty slot always ends the search.
+	while (st->slots[i] != NO_SYMBOL) {
+		symbol* sym = &st->symbols[st->slots[i]];
+		if (sym->hash == h && strcmp(sym->label, label) == 0) {
+			break;
+		}
+		i = (i + 1) & mask;
+	}
+	return &st->slots[i];
+}
+
+// Returns an array of n empty slots.
+static uint32_t* newSlots(uint32_t n) {
+	uint32_t* slots = malloc(n * sizeof(uint32_t));
+	assert(slots != NULL);
+	for (uint32_t i = 0; i < n; i++) {
+		slots[i] = NO_SYMBOL;
+	}
+	return slots;
+}
+
+// Doubles the number of slots and reinserts every symbol. Ids do not change.
+static void growSymbolTable(symbol_table* st) {
+	free(st->slots);
+	st->capacity *= 2;
+	st->slots = newSlots(st->capacity);
+
+	for (uint32_t id = 0; id < st->size; id++) {
+		*findSlot(st, st->symbols[id].label, st->symbols[id].hash) = id;
+	}
+}
 
 // Creates new symbol table.
 symbol_table* newSymbolTable() {
-    symbol_table* st = (symbol_table*) malloc (sizeof(symbol_table));
-    st->first = NULL;
-    st->size = 0;
-    return st;
+	symbol_table* st = (symbol_table*) malloc (sizeof(symbol_table));
+	assert(st != NULL);
+	st->capacity = INITIAL_SYMBOL_CAPACITY;
+	st->slots = newSlots(st->capacity);
+	st->symbolCapacity = INITIAL_SYMBOL_CAPACITY;
+	st->symbols = malloc(st->symbolCapacity * sizeof(symbol));
+	assert(st->symbols != NULL);
+	st->size = 0;
+	st->frozen = false;
+	st->arena = NULL;
+	st->fixupCapacity = INITIAL_FIXUP_CAPACITY;
+	st->fixups = malloc(st->fixupCapacity * sizeof(fixup));
+	assert(st->fixups != NULL);
+	st->numFixups = 0;
+	st->poolCapacity = INITIAL_POOL_CAPACITY;
+	st->pool = malloc(st->poolCapacity * sizeof(uint32_t));
+	st->poolValues = malloc(st->poolCapacity * sizeof(uint64_t));
+	assert(st->pool != NULL && st->poolValues != NULL);
+	st->poolSize = 0;
+	return st;
 }
 
-// Checks whether a given label is already in the table.
-bool hasLabel(symbol_table* st, char* label) {
-    symbol* sym = st->first;
+// Frees the table and its interned labels.
+void freeSymbolTable(symbol_table* st) {
+	label_block* block = st->arena;
+	while (block != NULL) {
+		label_block* next = block->next;
+		free(block);
+		block = next;
+	}
+	free(st->fixups);
+	free(st->pool);
+	free(st->poolValues);
+	free(st->symbols);
+	free(st->slots);
+	free(st);
+}
 
-	while (sym != NULL) {
-		if (strcmp(sym->label, label) == 0) {
-			return true;
-		}
-		sym = sym->next;
+// Returns the id of label, adding it (as not yet defined) if it is new.
+uint32_t symbolId(symbol_table* st, char* label) {
+	uint32_t h = hashLabel(label);
+	uint32_t* slot = findSlot(st, label, h);
+	if (*slot != NO_SYMBOL) {
+		return *slot;
+	}
+	if (st->frozen) {
+		fprintf(stderr, "Label (%s) not in symbol table.\n", label);
+		assemblyError();
+	}
+
+	if (st->size == st->symbolCapacity) {
+		st->symbolCapacity *= 2;
+		st->symbols = realloc(st->symbols, st->symbolCapacity * sizeof(symbol));
+		assert(st->symbols != NULL);
 	}
+	uint32_t id = st->size++;
+	symbol* sym = &st->symbols[id];
+	sym->label = internLabel(st, label);
+	sym->hash = h;
+	sym->address = 0;
+	sym->defined = false;
+	sym->pooled = false;
+	sym->fixups = NO_FIXUP;
+	*slot = id;
 
-    return false;
+	// Keep the load factor at most one half so probe sequences stay short.
+	if (2 * st->size > st->capacity) {
+		growSymbolTable(st);
+	}
+	return id;
 }
 
-// Check if token is a label
-bool isLabel(char* token) {
-	return strstr(token, ":");
+// Places the word offset from address to target into the field at start/len.
+static uint32_t offsetBits(uint32_t target, uint32_t address, uint8_t start, uint8_t len) {
+	return ISA_PUT_AT(start, len, (target - address) / INSTRUCTION_SIZE);
 }
 
-// Add symbol to start of symbol table
-void addSymbol(symbol_table* st, uint64_t address, char* label) {
-    assert(st->size < MAX_LABELS);
+// Checks whether a given label has been defined.
+bool hasLabel(symbol_table* st, char* label) {
+	uint32_t id = *findSlot(st, label, hashLabel(label));
+	return id != NO_SYMBOL && st->symbols[id].defined;
+}
 
-	symbol* sym = malloc(sizeof(symbol));
-    assert(sym != NULL);
-	sym->label = strdup(label);
+// Defines label at address and patches every earlier reference to it into out.
+void addSymbol(symbol_table* st, uint32_t address, char* label, output* out) {
+	// symbolId may move the symbols, so look the id up first.
+	uint32_t id = symbolId(st, label);
+	symbol* sym = &st->symbols[id];
+	if (sym->defined) {
+		fprintf(stderr, "Label (%s) defined more than once.\n", label);
+		assemblyError();
+	}
+	sym->defined = true;
 	sym->address = address;
-	sym->next = st->first;
-	st->first = sym;
-	st->size++;
+
+	for (uint32_t i = sym->fixups; i != NO_FIXUP; i = st->fixups[i].next) {
+		fixup* f = &st->fixups[i];
+		patchWord(out, f->address, offsetBits(address, f->address, f->start, f->len));
+	}
+	sym->fixups = NO_FIXUP;
+}
+
+// Defines the label on a trimmed label line ("name:") at address.
+void defineLabel(symbol_table* st, char* line, uint32_t address, output* out) {
+	// Remove colon since when labels are called don't have colon.
+	line[strlen(line) - 1] = '\0';
+	removeWhitespace(line);
+	addSymbol(st, address, line, out);
 }
 
-// Get address in symbol table from label, returns -1 otherwise. Note return int is signed.
-int32_t getAddress(symbol_table* st, char* label) {
-	symbol* sym = st->first;
+// Returns the offset from address to symbol id placed in the field at start/len.
+// A label that is not defined yet encodes as 0 and is patched when addSymbol defines it.
+uint32_t labelOffset(symbol_table* st, uint32_t id, uint32_t address, uint8_t start, uint8_t len) {
+	symbol* sym = &st->symbols[id];
+	if (sym->defined) {
+		return offsetBits(sym->address, address, start, len);
+	}
 
-	while (sym != NULL) {
-		if (strncmp(sym->label, label, strlen(sym->label)) == 0) {
-			return sym->address;
-		}
-		sym = sym->next;
+	if (st->numFixups == st->fixupCapacity) {
+		st->fixupCapacity *= 2;
+		st->fixups = realloc(st->fixups, st->fixupCapacity * sizeof(fixup));
+		assert(st->fixups != NULL);
 	}
+	fixup* f = &st->fixups[st->numFixups];
+	f->address = address;
+	f->start = start;
+	f->len = len;
+	f->next = sym->fixups;
+	sym->fixups = st->numFixups++;
+	return 0;
+}
 
-	fprintf(stderr, "Label (%s) not in symbol table.\n", label);
-    exit(EXIT_FAILURE);
+// Forgets every definition and pending fixup. Ids stay the same, so they can be kept across reassemblies.
+void resetSymbols(symbol_table* st) {
+	for (uint32_t id = 0; id < st->size; id++) {
+		st->symbols[id].defined = false;
+		st->symbols[id].pooled = false;
+		st->symbols[id].fixups = NO_FIXUP;
+	}
+	st->numFixups = 0;
+	st->poolSize = 0;
 }
 
-// Takes read files and adds any labels and corresponding addresses to symbol table.
-uint8_t populateSymbolTable(char buffer[MAX_LINES][MAX_CHARS_IN_LINE], symbol_table* st, uint8_t numRead) {
-	int numInstr = 0;
+/*
+Literal pool
+*/
 
-	for (int i = 0; i < numRead; i++) {
-		if (isLabel(buffer[i])) {
-			char* label = strdup(buffer[i]);
-			// Remove colon since when labels are called don't have colon.
-			removeWhitespace(label);
-			label[strlen(label) - 2] = '\0';
-			addSymbol(st, numInstr * INSTRUCTION_SIZE, label);
-		} else {
-			// Labels are not instructions (but take up an extra space in assembly code);
-			if (!isBlankLine(buffer[i])){
-				numInstr++;
-			}
-		}
+// Returns the symbol of the literal pool entry holding value, adding the entry if it is new.
+uint32_t poolSymbol(symbol_table* st, uint64_t value) {
+	char name[sizeof("=18446744073709551615")];
+	snprintf(name, sizeof(name), "=%llu", (unsigned long long) value);
+	uint32_t id = symbolId(st, name);
+
+	// Entries are shared by every load of the same value.
+	if (st->symbols[id].pooled) {
+		return id;
 	}
+	st->symbols[id].pooled = true;
+	if (st->poolSize == st->poolCapacity) {
+		st->poolCapacity *= 2;
+		st->pool = realloc(st->pool, st->poolCapacity * sizeof(uint32_t));
+		st->poolValues = realloc(st->poolValues, st->poolCapacity * sizeof(uint64_t));
+		assert(st->pool != NULL && st->poolValues != NULL);
+	}
+	st->pool[st->poolSize] = id;
+	st->poolValues[st->poolSize] = value;
+	st->poolSize++;
+	return id;
+}
+
+// Returns whether the pool starts with a padding word when placed at address.
+static bool poolPadded(symbol_table* st, uint32_t address) {
+	return st->poolSize > 0 && address % BYTES_IN_64BIT != 0;
+}
+
+// Defines the pool's symbols for a pool placed at address, right after the code, and patches
+// earlier loads from it into out. Returns the number of words the pool takes.
+uint32_t definePool(symbol_table* st, uint32_t address, output* out) {
+	uint32_t start = address + (poolPadded(st, address) ? INSTRUCTION_SIZE : 0);
+	for (uint32_t i = 0; i < st->poolSize; i++) {
+		addSymbol(st, start + i * BYTES_IN_64BIT, st->symbols[st->pool[i]].label, out);
+	}
+	return (start - address + st->poolSize * BYTES_IN_64BIT) / INSTRUCTION_SIZE;
+}
 
-	return numInstr;
+// Appends the pool to out, which must end where the pool was placed. Entries are 8-byte aligned.
+void emitPool(symbol_table* st, output* out) {
+	if (poolPadded(st, outputAddress(out))) {
+		emitWord(out, 0);
+	}
+	for (uint32_t i = 0; i < st->poolSize; i++) {
+		emitWord(out, (uint32_t) st->poolValues[i]);
+		emitWord(out, (uint32_t) (st->poolValues[i] >> 32));
+	}
+}
+
+// Exits if any referenced label was never defined.
+void checkUndefinedLabels(symbol_table* st) {
+	for (uint32_t id = 0; id < st->size; id++) {
+		if (!st->symbols[id].defined) {
+			fprintf(stderr, "Label (%s) not in symbol table.\n", st->symbols[id].label);
+			assemblyError();
+		}
+	}
 }
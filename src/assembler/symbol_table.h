@@ -5,14 +5,38 @@
 // Creates new symbol table.
 symbol_table* newSymbolTable();
 
-// Checks whether a given label is already in the table.
+// Frees the table and its interned labels.
+void freeSymbolTable(symbol_table* st);
+
+// Returns the id of label, adding it (as not yet defined) if it is new.
+// Once the table is frozen, an unknown label is an error.
+uint32_t symbolId(symbol_table* st, char* label);
+
+// Checks whether a given label has been defined.
 bool hasLabel(symbol_table* st, char* label);
 
-// Returns the address associated with a label or -1 if it is not present. (Note this int is signed)
-int32_t getAddress(symbol_table* table, char* label);
+// Defines label at address and patches every earlier reference to it into out.
+void addSymbol(symbol_table* st, uint32_t address, char* label, output* out);
+
+// Defines the label on a trimmed label line ("name:") at address.
+void defineLabel(symbol_table* st, char* line, uint32_t address, output* out);
+
+// Returns the offset from address to symbol id placed in the field at start/len.
+// A label that is not defined yet encodes as 0 and is patched when addSymbol defines it.
+uint32_t labelOffset(symbol_table* st, uint32_t id, uint32_t address, uint8_t start, uint8_t len);
+
+// Forgets every definition and pending fixup. Ids stay the same, so they can be kept across reassemblies.
+void resetSymbols(symbol_table* st);
+
+// Exits if any referenced label was never defined.
+void checkUndefinedLabels(symbol_table* st);
+
+// Returns the symbol of the literal pool entry holding value, adding the entry if it is new.
+uint32_t poolSymbol(symbol_table* st, uint64_t value);
 
-// Add symbol to start of symbol table
-void addSymbol(symbol_table* st, uint64_t address, char* label) ;
+// Defines the pool's symbols for a pool placed at address, right after the code, and patches
+// earlier loads from it into out. Returns the number of words the pool takes.
+uint32_t definePool(symbol_table* st, uint32_t address, output* out);
 
-// Check if token is a label
-bool isLabel(char* token);
+// Appends the pool to out, which must end where the pool was placed. Entries are 8-byte aligned.
+void emitPool(symbol_table* st, output* out);
@@ -2,51 +2,121 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdio.h>
-#include <assert.h>
+#include <ctype.h>
 #include "defs.h"
 #include "utils.h"
+#include "lexer.h"
 
-// Convert a line known to be an instruction into an instruction type
-void tokenizeInstruction(char* line, instruction* instr) {
-    char* saveptr;
-    char* token;
+// Splits a line longer than one lexer block a character at a time.
+static void tokenizeLong(char* line, instruction_text* instr) {
+    // Opcode runs up to the first whitespace
+    char* cursor = line;
+    while (*cursor != '\0' && !isspace((unsigned char) *cursor)) {
+        cursor++;
+    }
+    instr->opcode = line;
+    if (*cursor != '\0') {
+        *cursor++ = '\0';
+    }
 
-    // Get first token from line known to be instruction
-    token = strtok_r(line, " ", &saveptr); 
-    // If first token is null then return with error
-    assert(token != NULL);
+    // Operands are separated by commas, except inside square brackets
+    int i = 0;
+    while (*cursor != '\0') {
+        if (i == MAX_OPERANDS) {
+            fprintf(stderr, "Too many operands for %s.\n", instr->opcode);
+            assemblyError();
+        }
 
-    // Obtain opcode from first token
-    instr->opcode = token;
+        char* operand = cursor;
+        int depth = 0;
+        while (*cursor != '\0' && (*cursor != ',' || depth > 0)) {
+            if (*cursor == '[') {
+                depth++;
+            } else if (*cursor == ']') {
+                depth--;
+            }
+            cursor++;
+        }
+        if (*cursor == ',') {
+            *cursor++ = '\0';
+        }
 
-    // Get second token (Required by loop structure) and initialise operand array builder
-    token = strtok_r(NULL, ",\n", &saveptr);
+        removeWhitespace(operand);
+        instr->operands[i++] = operand;
+    }
+
+    for (int j = i; j < MAX_OPERANDS; j++) {
+        instr->operands[j] = "";
+    }
+}
 
-    // Add operand tokens to operand array builder until end of line
+// Mask of bits from (inclusive) to to (exclusive), to at most LEX_BLOCK_SIZE.
+static uint64_t bitRange(size_t from, size_t to) {
+    uint64_t below = to == LEX_BLOCK_SIZE ? ~(uint64_t) 0 : ((uint64_t) 1 << to) - 1;
+    return below & ~(((uint64_t) 1 << from) - 1);
+}
+
+// Convert a line known to be an instruction into an instruction type.
+// The line is split in place: opcode and operands point into it, so nothing is allocated.
+// Lines that fit in a lexer block, nearly all of them, are split using its character masks:
+// separators and whitespace are found by walking set bits rather than every character.
+void tokenizeInstruction(char* line, instruction_text* instr) {
+    size_t length = strlen(line);
+    if (length > LEX_BLOCK_SIZE) {
+        tokenizeLong(line, instr);
+        return;
+    }
+    char_masks masks;
+    classifyBlock(line, length, &masks);
+
+    // Opcode runs up to the first whitespace
+    size_t cursor = masks.space != 0 ? (size_t) __builtin_ctzll(masks.space) : length;
+    instr->opcode = line;
+    if (cursor < length) {
+        line[cursor++] = '\0';
+    }
+
+    // Operands are separated by commas, except inside square brackets
+    uint64_t separators = masks.comma | masks.open | masks.close;
     int i = 0;
-    while (token != NULL) {
-        // Make copy of token for modification that does not interfere with strtok
-        char* formatted_token = strdup(token);
-        removeWhitespace(formatted_token);
-        // Deal with in-operand delimiter cases
-        if (formatted_token[0] == '[' && token[strlen(token) - 1] != ']') {
-            // Merge succesive tokens contained within a set of square brakcets
-            strcat(formatted_token, ",");
-            token = strtok_r(NULL, ",\n", &saveptr);
-            char* next_formatted_token = strdup(token);
-            removeWhitespace(next_formatted_token);
-            char* concat_token = (char*) malloc(strlen(formatted_token) + strlen(next_formatted_token));
-            strcat(concat_token, formatted_token);
-            strcat(concat_token, next_formatted_token);
-            instr->operands[i] = concat_token;
-        } else {
-            instr->operands[i] = formatted_token;
+    while (cursor < length) {
+        if (i == MAX_OPERANDS) {
+            fprintf(stderr, "Too many operands for %s.\n", instr->opcode);
+            assemblyError();
+        }
+
+        size_t end = length;
+        int depth = 0;
+        for (uint64_t rest = separators & bitRange(cursor, length); rest != 0; rest &= rest - 1) {
+            size_t at = __builtin_ctzll(rest);
+            if (line[at] == '[') {
+                depth++;
+            } else if (line[at] == ']') {
+                depth--;
+            } else if (depth <= 0) {
+                end = at;
+                break;
+            }
+        }
+
+        // Whitespace is squeezed out by copying the other characters down over it.
+        char* operand = line + cursor;
+        uint64_t range = bitRange(cursor, end);
+        if ((masks.space & range) != 0) {
+            char* write = operand;
+            for (uint64_t keep = ~masks.space & range; keep != 0; keep &= keep - 1) {
+                *write++ = line[__builtin_ctzll(keep)];
+            }
+            *write = '\0';
+        }
+        if (end < length) {
+            line[end] = '\0';
         }
-        token = strtok_r(NULL, ",\n", &saveptr);
-        i++;
+        instr->operands[i++] = operand;
+        cursor = end + 1;
     }
 
     for (int j = i; j < MAX_OPERANDS; j++) {
         instr->operands[j] = "";
     }
-}
\ No newline at end of file
+}
@@ -5,4 +5,4 @@
 // void tokenize(char* line);
 
 // Convert a line known to be an instruction into an instruction type
-void tokenizeInstruction(char* line, instruction* instr);
+void tokenizeInstruction(char* line, instruction_text* instr);
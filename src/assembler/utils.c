@@ -5,115 +5,66 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
 #include "defs.h"
 #include "symbol_table.h"
+#include "utils.h"
+#include "binary_file.h"
 
-extern symbol_table* st;
+// Each thread's error trap, if it has one.
+static pthread_key_t trapKey;
+static pthread_once_t trapKeyOnce = PTHREAD_ONCE_INIT;
 
-// Writes n instructions from array into binary file
-void writeBinary(char* path, uint32_t* instructions, int n) {
-	// Creating the output file
-	FILE* output = fopen(path, "wb");
-
-	// Check if file has been loaded into memory
-	if(output == NULL) {
-		fprintf(stderr, "Error opening file at %s\n", path);
-		exit(EXIT_FAILURE);
-	}
-
-	for (int i = 0; i < n; i++) {
-		fwrite(&(instructions[i]), sizeof(uint32_t), 1, output);
-	}
-
-	fclose(output);
+static void createTrapKey(void) {
+	pthread_key_create(&trapKey, NULL);
 }
 
-// Reads each line of file into buffer with maximum of MAX_LINES lines. Returns number of lines read.
-uint8_t readFile(char buffer[MAX_LINES][MAX_CHARS_IN_LINE], char* path) {
-
-	// Input file
-	FILE* input = fopen(path, "r");
+// Makes assembly errors on the calling thread longjmp to trap, or exit the process again if it is NULL.
+void catchErrors(error_trap* trap) {
+	pthread_once(&trapKeyOnce, createTrapKey);
+	pthread_setspecific(trapKey, trap);
+}
 
-	// Verifying the input
-	if (input == NULL) {
-		printf("ERROR: Cannot open file: %s\n", path);
+// Ends an assembly whose error has been printed: jumps to the calling thread's trap, or exits.
+void assemblyError(void) {
+	pthread_once(&trapKeyOnce, createTrapKey);
+	error_trap* trap = pthread_getspecific(trapKey);
+	if (trap == NULL) {
 		exit(EXIT_FAILURE);
 	}
-
-	// Read content of input file
-	uint8_t i = 0;
-	while(fgets(buffer[i], MAX_CHARS_IN_LINE, input)) {
-		i++;
-	}
-
-	fclose(input);
-	return i;
-}
-
-// Checks if operand is a 64bit register
-bool is64BitReg(char* operand) {
-	assert(operand != NULL && strlen(operand) > 0);
-	// 64 bit registers are of the form "x##"
-	return strncmp(operand, "x", 1) == 0;
+	longjmp(trap->jump, 1);
 }
 
-// Returns string for correct zero register
-char* getZeroReg(char* operand) {
-	return is64BitReg(operand) ? OPERAND_XZR : OPERAND_WZR;
+// Writes n instructions from array into binary file.
+// Regular files are replaced atomically: the words go to a temporary file next to path in one
+// write, which is then renamed over path, so readers never see a partly written binary.
+void writeBinary(char* path, uint32_t* instructions, uint32_t n) {
+	if (!replaceFile(path, instructions, (size_t) n * sizeof(uint32_t))) {
+		fprintf(stderr, "Error writing file at %s\n", path);
+		assemblyError();
+	}
 }
 
-// Returns register number from operand
-uint32_t getRegNum(char* operand) {
-	assert(operand != NULL);
-
-	char* reg = strdup(operand);
-
-	if (strncmp(reg, "[", 1) == 0) {
-		reg++;
+// Writes n instructions from array into a new binary file at path, unless a file is already there.
+// Like writeBinary, the file appears whole. Returns whether this call created it.
+bool writeNewBinary(char* path, uint32_t* instructions, uint32_t n) {
+	char* temporary = writeTemporaryFile(path, instructions, (size_t) n * sizeof(uint32_t));
+	if (temporary == NULL) {
+		fprintf(stderr, "Error writing file at %s\n", path);
+		assemblyError();
 	}
-
-	if (strncmp(reg, "xzr", 3) == 0 || strncmp(reg, "wzr", 3) == 0) {
-		return ZR_INDEX;
+	// Unlike rename, link does not replace an existing file, so of several writers exactly one succeeds.
+	bool created = link(temporary, path) == 0;
+	bool exists = created || errno == EEXIST;
+	unlink(temporary);
+	free(temporary);
+	if (!exists) {
+		fprintf(stderr, "Error writing file at %s\n", path);
+		assemblyError();
 	}
-
-	// reg++ moves pointer past w or x index for registers.
-	reg++;
-	return (uint32_t) atoi(reg);
-}
-
-
-// Returns unsigned literal number for operand starting with #
-uint32_t getImmediate(char* operand) {
-	assert(operand != NULL);
-
-	// Go past #
-	operand++;
-
-	if (strncmp(operand, "0x", 2) == 0) {
-        return (uint32_t) strtol(operand, NULL, HEX_BASE);
-    }
-    return (uint32_t) strtol(operand, NULL, DENARY_BASE);
-}
-
-// generates binary mask of n ones.
-uint64_t generateMask(uint32_t n) {
-    return ((1 << n) - 1);
-}
-
-// Returns the hash used to find the instruction function given the opcode.
-uint8_t hash(char* t) {
-
-	// Manually check for 'b' and 'br' since they are not long enough to has using the hash function.
-	// This avoid accessing memory which is inconsitent (and would break the hash function).
-	if (strncmp(t, "nop", 3) == 0) {
-		return 53;
-	} else if (strlen(t) == 1) {
-        return 11;
-    } else if (strlen(t) == 2) {
-        return 13;
-    }
-
-	return (710 * (t[0] ^ t[1]) ^ 21 * (t[2] ^ t[3])) % 59;
+	return created;
 }
 
 // check if line is blank
@@ -122,48 +73,13 @@ bool isBlankLine(char *line) {
 	return strcmp(line, "\n") == 0 || strcmp(line, "\0") == 0 || strcmp(line, "\r\n") == 0; 
 }
 
-// Returns if given operand is a register.
-// If returns false, operand is either label or immediate address.
-bool isRegister(char *operand) {
-	return (strncmp(operand, "x", 1) == 0 || strncmp(operand, "w", 1) == 0);
-}
-
-// Returns if given operand is an immediate value.
-bool isImmediate(char *operand) {
-	return (strncmp(operand, "#", 1) == 0);
-}
-
-// Calculates of the offset between an operand and the line number of the instruction. 
-uint32_t calculateOffset(char* operand, uint8_t lineaddress, uint8_t len) {
-	uint32_t offset;
-
-    if (isImmediate(operand)) {
-        // treat as immediate value
-		offset = getImmediate(operand);
-    } else {
-		// treat as label
-		offset = getAddress(st, operand) - lineaddress;	
-	}
-
-	// Truncates offset to desired length so it can be bitshifted
-	return offset & generateMask(len + MASK_OFFSET) ;
-}
-
-// Remvoes all lines that return true when passed into fn.
-uint8_t skipBlanks (char buffer[MAX_LINES][MAX_CHARS_IN_LINE], int numRead) {
-	int read_line = 0;
-	for (int write_line = 0; write_line < numRead; write_line++){
-		if (strlen(buffer[write_line]) != 1) {
-			for (int k = 0; k < MAX_CHARS_IN_LINE; k++){
-				buffer[read_line][k] = buffer[write_line][k];
-			}
-			read_line++;
-		}
-		}	
-	for (int i = read_line; i < numRead; i++){
-		buffer[i][0] = '\0';
+// Encodes the word offset from the instruction at address to an immediate byte offset or a label
+// into the field at start/len. Forward label references are filled in once the label is defined.
+uint32_t encodeOffset(symbol_table* st, operand* target, uint32_t address, uint8_t start, uint8_t len) {
+	if (target->kind == OPERAND_LABEL) {
+		return labelOffset(st, target->symbol, address, start, len);
 	}
-	return read_line;	
+	return ISA_PUT_AT(start, len, target->imm / INSTRUCTION_SIZE);
 }
 
 // Removes all whitespace from input string
@@ -171,7 +87,7 @@ void removeWhitespace(char* str) {
     int count = 0;
 	
     for (int i = 0; str[i]; i++) {
-        if (str[i] != ' ') {
+        if (!isspace((unsigned char) str[i])) {
             str[count++] = str[i];
 		}
 	}	
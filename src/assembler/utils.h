@@ -1,52 +1,41 @@
+#ifndef UTILS_H
+#define UTILS_H
+
 #include <stdint.h>
 #include <stdbool.h>
+#include <setjmp.h>
 #include "defs.h"
 
-// Writes n instructions from array into binary file
-void writeBinary(char* path, uint32_t* instructions, int n);
-
-// Reads each line of file into buffer with maximum of MAX_LINES lines. Returns number of lines read.
-uint8_t readFile(char buffer[MAX_LINES][MAX_CHARS_IN_LINE], char* path);
-
-// Takes read files and adds any labels and corresponding addresses to symbol table.
-uint8_t populateSymbolTable(char buffer[MAX_LINES][MAX_CHARS_IN_LINE], symbol_table* st, uint8_t numRead);
-
-// Returns the hash used to find the instruction function given the opcode.
-uint8_t hash(char* t);
+// Where an assembly error on a thread goes instead of ending the process. The caller marks the
+// point to return to with setjmp(trap.jump), then passes the trap to catchErrors.
+typedef struct {
+	jmp_buf jump;
+} error_trap;
 
-// Checks if operand is a 64bit register
-bool is64BitReg(char* operand);
+// Makes assembly errors on the calling thread longjmp to trap, or exit the process again if it is NULL.
+void catchErrors(error_trap* trap);
 
-// Returns string for correct zero register
-char* getZeroReg(char* operand);
+// Ends an assembly whose error has been printed: jumps to the calling thread's trap, or exits.
+__attribute__((noreturn)) void assemblyError(void);
 
-// Returns register number from operand
-uint32_t getRegNum(char* operand);
+// Writes n instructions from array into binary file, replacing it atomically.
+void writeBinary(char* path, uint32_t* instructions, uint32_t n);
 
-// Returns literal number for operand starting with #
-uint32_t getImmediate(char* operand);
+// Writes n instructions from array into a new binary file at path, unless a file is already there.
+// Like writeBinary, the file appears whole. Returns whether this call created it.
+bool writeNewBinary(char* path, uint32_t* instructions, uint32_t n);
 
 // check if line is blank
 bool isBlankLine(char *line);
 
-// Returns if given operand is a register.
-// If returns false, assume that it is a literal.
-bool isRegister(char *operand);
-
-// Returns if given operand is an immediate value.
-bool isImmediate(char *operand);
-
-// Remvoes all lines that return true when passedi nto fn.
-uint8_t skipBlanks(char buffer[MAX_LINES][MAX_CHARS_IN_LINE], int numRead);
-
 // Removes all whitespace from input string
 void removeWhitespace(char* str);
 
 // Removes potential leading and trailing whitespace
 void trimWhitespace(char* str);
 
-// Calculates of the offset between an operand and the line number of the instruction. 
-uint32_t calculateOffset(char* operand, uint8_t lineaddress, uint8_t len);
+// Encodes the word offset from the instruction at address to an immediate byte offset or a label
+// into the field at start/len. Forward label references are filled in once the label is defined.
+uint32_t encodeOffset(symbol_table* st, operand* target, uint32_t address, uint8_t start, uint8_t len);
 
-// generates binary mask of n ones.
-uint64_t generateMask(uint32_t n);
\ No newline at end of file
+#endif
@@ -0,0 +1,348 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "defs.h"
+#include "utils.h"
+#include "symbol_table.h"
+#include "instructions.h"
+#include "directives.h"
+#include "tokenize.h"
+#include "parse.h"
+#include "source.h"
+#include "output.h"
+#include "watch.h"
+
+#define WATCH_INTERVAL_MS 200 // between checks of the source's modification time
+#define INITIAL_LINE_CACHE_CAPACITY 1024
+
+typedef enum { LINE_BLANK, LINE_LABEL, LINE_INSTRUCTION, LINE_DATA } LINE_KIND;
+
+// Cached result of one source line. An instruction's words only depend on its address
+// through its label operand, so they stay valid while the label is the same distance away.
+// Data directives are not cached: their words are copied out again every round.
+typedef struct {
+    uint64_t hash;   // of the raw line text
+    size_t length;
+    uint8_t kind;
+    size_t position; // of the line in the current source
+    uint32_t words[MAX_INSTRUCTION_WORDS];
+    uint32_t size;   // number of words
+    uint32_t label;  // symbol the words depend on, or NO_SYMBOL
+    int64_t offset;  // label address minus instruction address when the words were encoded
+} cached_line;
+
+// Source lines as of the last assembly, with the words that were written for them.
+// text is a copy of the source they were read from, so lines can be compared byte for byte
+// after the file has changed.
+typedef struct {
+    cached_line* lines;
+    uint32_t size;
+    uint32_t capacity;
+    output* out;
+    char* text;
+} line_cache;
+
+// A round of reassembly in progress. It lives on the heap so that, when an assembly error
+// jumps out of the round, whatever it had opened can still be freed.
+typedef struct {
+    source* src;
+    line_cache next;
+} watch_round;
+
+// Returns the 64-bit FNV-1a hash of a raw line.
+static uint64_t hashLine(char* start, size_t length) {
+    uint64_t h = 14695981039346656037u;
+    for (size_t i = 0; i < length; i++) {
+        h = (h ^ (unsigned char) start[i]) * 1099511628211u;
+    }
+    return h;
+}
+
+static void newLineCache(line_cache* cache) {
+    cache->capacity = INITIAL_LINE_CACHE_CAPACITY;
+    cache->lines = malloc(cache->capacity * sizeof(cached_line));
+    assert(cache->lines != NULL);
+    cache->size = 0;
+    cache->out = newOutput();
+    cache->text = NULL;
+}
+
+static void freeLineCache(line_cache* cache) {
+    free(cache->lines);
+    freeOutput(cache->out);
+    free(cache->text);
+}
+
+// Appends an entry for a raw line, growing the cache as needed.
+static cached_line* addLine(line_cache* cache, line_scan* scan, size_t position) {
+    if (cache->size == cache->capacity) {
+        cache->capacity *= 2;
+        cache->lines = realloc(cache->lines, cache->capacity * sizeof(cached_line));
+        assert(cache->lines != NULL);
+    }
+    cached_line* line = &cache->lines[cache->size++];
+    line->hash = hashLine(scan->start, scan->length);
+    line->length = scan->length;
+    line->position = position;
+    line->label = NO_SYMBOL;
+    if (scan->colon) {
+        line->kind = LINE_LABEL;
+    } else if (isBlankScan(scan)) {
+        line->kind = LINE_BLANK;
+    } else if (isDataText(scan->start + scan->first, scan->last - scan->first)) {
+        line->kind = LINE_DATA;
+    } else {
+        line->kind = LINE_INSTRUCTION;
+    }
+    return line;
+}
+
+// Returns whether line i of the new source (still open as src) is line j of the cache's.
+static bool sameLine(source* src, line_cache* next, uint32_t i, line_cache* cache, uint32_t j) {
+    cached_line* a = &next->lines[i];
+    cached_line* b = &cache->lines[j];
+    // The hash rules out almost every edited line before the bytes are compared.
+    return a->hash == b->hash && a->length == b->length
+        && memcmp(src->data + a->position, cache->text + b->position, a->length) == 0;
+}
+
+// Encodes an instruction line from scratch and records the label its words depend on.
+static void encodeLine(symbol_table* st, source* src, cached_line* line, uint32_t lineNumber, uint32_t address) {
+    line_scan scan;
+    src->position = line->position;
+    scanLine(src, &scan);
+    copyScanned(src, &scan);
+
+    instruction_text text;
+    instruction ins;
+    tokenizeInstruction(src->line, &text);
+    if (!parseInstruction(st, &text, &ins)) {
+        fprintf(stderr, "Unknown instruction (%s) on line %u.\n", text.opcode, lineNumber);
+        assemblyError();
+    }
+
+    line->label = NO_SYMBOL;
+    for (uint8_t i = 0; i < ins.numOperands; i++) {
+        if (ins.operands[i].kind == OPERAND_LABEL) {
+            line->label = ins.operands[i].symbol;
+        }
+    }
+    if (line->label != NO_SYMBOL) {
+        symbol* sym = &st->symbols[line->label];
+        if (!sym->defined) {
+            fprintf(stderr, "Label (%s) not in symbol table.\n", sym->label);
+            assemblyError();
+        }
+        line->offset = (int64_t) sym->address - address;
+    }
+    line->size = encodeWords(st, &ins, address, line->words);
+}
+
+// Appends the words of a data directive line, sized by the label pass, to out.
+static void writeDataLine(source* src, cached_line* line, uint32_t lineNumber, output* out) {
+    line_scan scan;
+    src->position = line->position;
+    scanLine(src, &scan);
+    copyScanned(src, &scan);
+    writeData(src->line, lineNumber, reserveWords(out, line->size), line->size);
+}
+
+// Returns whether cached words are still right for an unedited line now placed at address.
+static bool stillValid(symbol_table* st, cached_line* line, uint32_t address) {
+    if (line->label == NO_SYMBOL) {
+        return true;
+    }
+    symbol* sym = &st->symbols[line->label];
+    return sym->defined && (int64_t) sym->address - address == line->offset;
+}
+
+// Writes the words of out that differ from previous to the file at path, which is assumed to
+// hold previous. Runs of changed words are written with one pwrite each. Returns the words written.
+static uint32_t patchBinary(char* path, output* previous, output* out) {
+    // With nothing written yet, whatever the file held before is discarded.
+    int fd = open(path, O_WRONLY | O_CREAT | (previous->size == 0 ? O_TRUNC : 0), 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Error opening file at %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+
+    uint32_t written = 0;
+    uint32_t i = 0;
+    while (i < out->size) {
+        if (i < previous->size && previous->words[i] == out->words[i]) {
+            i++;
+            continue;
+        }
+        uint32_t first = i;
+        while (i < out->size && (i >= previous->size || previous->words[i] != out->words[i])) {
+            i++;
+        }
+        size_t bytes = (size_t) (i - first) * sizeof(uint32_t);
+        if (pwrite(fd, &out->words[first], bytes, (off_t) first * sizeof(uint32_t)) != (ssize_t) bytes) {
+            fprintf(stderr, "Error writing file at %s\n", path);
+            exit(EXIT_FAILURE);
+        }
+        written += i - first;
+    }
+
+    if (out->size != previous->size && ftruncate(fd, (off_t) out->size * sizeof(uint32_t)) != 0) {
+        fprintf(stderr, "Error writing file at %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    close(fd);
+    return written;
+}
+
+// Reassembles the file at inPath against the cache of its previous version and patches outPath.
+// Only edited lines and instructions whose label moved relative to them are encoded again.
+// The cache and the binary are only replaced once the whole source has assembled.
+static void reassemble(symbol_table* st, char* inPath, char* outPath, line_cache* cache, watch_round* round) {
+    round->src = openSource(inPath);
+    source* src = round->src;
+    newLineCache(&round->next);
+    line_cache* next = &round->next;
+
+    // Labels are cheap to find, so every round redefines all of them, along with the literal pool
+    // after the code. Ids are kept across rounds.
+    resetSymbols(st);
+    uint32_t address = 0;
+    size_t position = src->position;
+    line_scan scan;
+    while (scanLine(src, &scan)) {
+        cached_line* line = addLine(next, &scan, position);
+        if (line->kind == LINE_LABEL) {
+            copyScanned(src, &scan);
+            defineLabel(st, src->line, address, next->out);
+        } else if (line->kind != LINE_BLANK) {
+            line->size = 1;
+            if (mayTakeSeveralWords(&scan)) {
+                copyScanned(src, &scan);
+                line->size = lineSize(st, src->line, src->lineNumber);
+            }
+            address += line->size * INSTRUCTION_SIZE;
+        }
+        position = src->position;
+    }
+    definePool(st, address, next->out);
+
+    // Lines before and after the edited region are matched up with their old selves.
+    uint32_t prefix = 0;
+    while (prefix < next->size && prefix < cache->size && sameLine(src, next, prefix, cache, prefix)) {
+        prefix++;
+    }
+    uint32_t suffix = 0;
+    while (suffix < next->size - prefix && suffix < cache->size - prefix
+           && sameLine(src, next, next->size - 1 - suffix, cache, cache->size - 1 - suffix)) {
+        suffix++;
+    }
+
+    uint32_t encoded = 0;
+    uint32_t instructions = 0;
+    for (uint32_t i = 0; i < next->size; i++) {
+        cached_line* line = &next->lines[i];
+        if (line->kind == LINE_DATA) {
+            writeDataLine(src, line, i + 1, next->out);
+        }
+        if (line->kind != LINE_INSTRUCTION) {
+            continue;
+        }
+        address = outputAddress(next->out);
+        instructions++;
+
+        cached_line* old = NULL;
+        if (i < prefix) {
+            old = &cache->lines[i];
+        } else if (i >= next->size - suffix) {
+            old = &cache->lines[i - next->size + cache->size];
+        }
+
+        if (old != NULL && stillValid(st, old, address)) {
+            memcpy(line->words, old->words, sizeof(line->words));
+            line->label = old->label;
+            line->offset = old->offset;
+        } else {
+            encodeLine(st, src, line, i + 1, address);
+            encoded++;
+        }
+        for (uint8_t w = 0; w < line->size; w++) {
+            emitWord(next->out, line->words[w]);
+        }
+    }
+    emitPool(st, next->out);
+
+    uint32_t patched = patchBinary(outPath, cache->out, next->out);
+    fprintf(stderr, "assemble: %s: %u of %u instructions encoded, %u words written.\n",
+            inPath, encoded, instructions, patched);
+
+    next->text = malloc(src->size > 0 ? src->size : 1);
+    assert(next->text != NULL);
+    memcpy(next->text, src->data, src->size);
+    closeSource(src);
+    round->src = NULL;
+    freeLineCache(cache);
+    *cache = *next;
+    round->next.lines = NULL;
+}
+
+// Runs a round of reassembly. An error in the source is reported and leaves the last good binary
+// (and the cache that matches it) in place for the next change.
+static void reassembleOrReport(symbol_table* st, char* inPath, char* outPath, line_cache* cache) {
+    watch_round* round = calloc(1, sizeof(watch_round));
+    assert(round != NULL);
+    error_trap trap;
+    if (setjmp(trap.jump) == 0) {
+        catchErrors(&trap);
+        reassemble(st, inPath, outPath, cache, round);
+    } else {
+        fprintf(stderr, "assemble: %s: not assembled; waiting for the next change.\n", inPath);
+        if (round->src != NULL) {
+            closeSource(round->src);
+        }
+        if (round->next.lines != NULL) {
+            freeLineCache(&round->next);
+        }
+    }
+    catchErrors(NULL);
+    free(round);
+}
+
+// Returns the modification time of path, or a zero time if it cannot be read.
+static struct timespec modificationTime(char* path) {
+    struct stat info;
+    if (stat(path, &info) != 0) {
+        struct timespec none = {0, 0};
+        return none;
+    }
+    return info.st_mtim;
+}
+
+// Assembles inPath to outPath, then polls inPath and reassembles it incrementally whenever it
+// changes. The binary is patched in place rather than rewritten. A source with an error is reported
+// and the last good binary kept until the next change. Does not return.
+void watchSource(char* inPath, char* outPath) {
+    // The table lives as long as the watch, so label ids stay the same across rounds.
+    symbol_table* st = newSymbolTable();
+    line_cache cache;
+    newLineCache(&cache);
+
+    struct timespec interval = {0, WATCH_INTERVAL_MS * 1000000L};
+    struct timespec seen = modificationTime(inPath);
+    reassembleOrReport(st, inPath, outPath, &cache);
+
+    while (true) {
+        nanosleep(&interval, NULL);
+        struct timespec now = modificationTime(inPath);
+        if (now.tv_sec == seen.tv_sec && now.tv_nsec == seen.tv_nsec) {
+            continue;
+        }
+        seen = now;
+        reassembleOrReport(st, inPath, outPath, &cache);
+    }
+}
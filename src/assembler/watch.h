@@ -0,0 +1,4 @@
+// Assembles inPath to outPath, then polls inPath and reassembles it incrementally whenever it
+// changes. The binary is patched in place rather than rewritten. A source with an error is reported
+// and the last good binary kept until the next change. Does not return.
+void watchSource(char* inPath, char* outPath);
@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "binary_file.h"
+
+#define TEMPORARY_FORMAT "%s.%ld.%u" // output path, process id and a per-process count
+#define TEMPORARY_EXTRA 32 // bytes the format adds to the path, at most
+
+// Writes all of buffer to fd, retrying short writes. Returns false on error.
+static bool writeAll(int fd, char* buffer, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, buffer, size);
+        if (written < 0) {
+            return false;
+        }
+        buffer += written;
+        size -= written;
+    }
+    return true;
+}
+
+// Writes size bytes of data to a new temporary file next to path and returns its name, which the
+// caller frees, or NULL on error.
+char* writeTemporaryFile(char* path, void* data, size_t size) {
+    // The kernel applies the umask to a new file itself, so (unlike mkstemp and fchmod) this needs
+    // no access to the process-wide umask, which batch workers would race on. Names are unique
+    // within the process; O_EXCL skips any left behind by another.
+    static uint32_t temporaries = 0;
+    size_t length = strlen(path) + TEMPORARY_EXTRA;
+    char* temporary = malloc(length);
+    assert(temporary != NULL);
+    int fd;
+    do {
+        uint32_t count = __atomic_fetch_add(&temporaries, 1, __ATOMIC_RELAXED);
+        snprintf(temporary, length, TEMPORARY_FORMAT, path, (long) getpid(), count);
+        fd = open(temporary, O_WRONLY | O_CREAT | O_EXCL, 0666);
+    } while (fd < 0 && errno == EEXIST);
+    if (fd < 0) {
+        free(temporary);
+        return NULL;
+    }
+
+    bool ok = writeAll(fd, data, size);
+    ok = close(fd) == 0 && ok;
+    if (!ok) {
+        unlink(temporary);
+        free(temporary);
+        return NULL;
+    }
+    return temporary;
+}
+
+// Writes size bytes of data to path, replacing a regular file atomically; devices and pipes are
+// written directly. Returns false on error.
+bool replaceFile(char* path, void* data, size_t size) {
+    // Devices and pipes (e.g. /dev/stdout) cannot be renamed over.
+    struct stat info;
+    if (stat(path, &info) == 0 && !S_ISREG(info.st_mode)) {
+        int fd = open(path, O_WRONLY);
+        if (fd < 0) {
+            return false;
+        }
+        bool ok = writeAll(fd, data, size);
+        return close(fd) == 0 && ok;
+    }
+
+    char* temporary = writeTemporaryFile(path, data, size);
+    if (temporary == NULL) {
+        return false;
+    }
+    bool ok = rename(temporary, path) == 0;
+    if (!ok) {
+        unlink(temporary);
+    }
+    free(temporary);
+    return ok;
+}
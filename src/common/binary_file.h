@@ -0,0 +1,20 @@
+#ifndef BINARY_FILE_H
+#define BINARY_FILE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Output files shared by assemble and link. Regular files appear whole: the data goes to a temporary
+// file next to the path in one write, which is then moved into place, so readers never see a partly
+// written binary.
+
+// Writes size bytes of data to a new temporary file next to path and returns its name, which the
+// caller frees, or NULL on error.
+char* writeTemporaryFile(char* path, void* data, size_t size);
+
+// Writes size bytes of data to path, replacing a regular file atomically; devices and pipes are
+// written directly. Returns false on error.
+bool replaceFile(char* path, void* data, size_t size);
+
+#endif
@@ -0,0 +1,291 @@
+#ifndef ISA_H
+#define ISA_H
+
+#include <stdint.h>
+
+// Single description of the AArch64 subset shared by the assembler and the emulator.
+// Both sides expand the X-macro tables below, so an encoding only has to be written once.
+
+/*
+INSTRUCTION FIELDS
+*/
+
+// X(name, lowest bit, length in bits)
+#define ISA_FIELDS(X) \
+    X(OP0, 25, 4) \
+    /* Data processing (shared by immediate and register) */ \
+    X(DP_RD, 0, 5) \
+    X(DP_RN, 5, 5) \
+    X(DP_OPC, 29, 2) \
+    X(DP_SF, 31, 1) \
+    /* Data processing immediate */ \
+    X(DPI_OPI, 23, 3) \
+    X(DPI_SH, 22, 1) \
+    X(DPI_IMM12, 10, 12) \
+    X(DPI_IMM16, 5, 16) \
+    X(DPI_HW, 21, 2) \
+    /* Data processing register */ \
+    X(DPR_RM, 16, 5) \
+    X(DPR_IMM6, 10, 6) \
+    X(DPR_N, 21, 1) \
+    X(DPR_SHIFT, 22, 2) \
+    X(DPR_ARITHMETIC, 24, 1) \
+    X(DPR_M, 28, 1) \
+    X(DPR_RA, 10, 5) \
+    X(DPR_X, 15, 1) \
+    /* Single data transfer */ \
+    X(SDT_RT, 0, 5) \
+    X(SDT_XN, 5, 5) \
+    X(SDT_SIMM19, 5, 19) \
+    X(SDT_INDEXED, 10, 1) \
+    X(SDT_IMM12, 10, 12) \
+    X(SDT_I, 11, 1) \
+    X(SDT_SIMM9, 12, 9) \
+    X(SDT_XM, 16, 5) \
+    X(SDT_L, 22, 1) \
+    X(SDT_U, 24, 1) \
+    X(SDT_SINGLE, 28, 1) /* clear for register pairs */ \
+    X(SDT_NOT_LITERAL, 29, 1) \
+    X(SDT_SF, 30, 1) /* for load literal */ \
+    X(SDT_SIZE, 30, 2) /* log2 of transfer size in bytes */ \
+    /* Register pair data transfer */ \
+    X(PAIR_RT2, 10, 5) \
+    X(PAIR_IMM7, 15, 7) \
+    X(PAIR_MODE, 23, 2) \
+    X(PAIR_SF, 31, 1) \
+    /* Branch */ \
+    X(BR_COND, 0, 4) \
+    X(BR_RT, 0, 5) /* for compare and branch */ \
+    X(BR_SIMM26, 0, 26) \
+    X(BR_SIMM19, 5, 19) \
+    X(BR_XN, 5, 5) \
+    X(BR_REG_OPC, 21, 2) \
+    X(BR_CB_NONZERO, 24, 1) \
+    X(BR_TYPE, 29, 3) \
+    X(BR_CB_SF, 31, 1)
+
+#define ISA_FIELD_ENUM(name, start, len) name##_START = (start), name##_LEN = (len),
+enum { ISA_FIELDS(ISA_FIELD_ENUM) };
+#undef ISA_FIELD_ENUM
+
+// Mask of the low l bits.
+#define ISA_MASK(l) ((uint32_t) (((uint64_t) 1 << (l)) - 1))
+
+// Extracts field f from an instruction word.
+#define ISA_GET(f, instr) ((((uint32_t) (instr)) >> f##_START) & ISA_MASK(f##_LEN))
+
+// Extracts field f from an instruction word and sign extends it to 64 bits.
+#define ISA_GET_SIGNED(f, instr) \
+    ((int64_t) ((ISA_GET(f, instr) ^ ((uint64_t) 1 << (f##_LEN - 1))) - ((uint64_t) 1 << (f##_LEN - 1))))
+
+// Places value v into field f, truncating it to the field width (so negative values encode as two's complement).
+#define ISA_PUT(f, v) ISA_PUT_AT(f##_START, f##_LEN, v)
+
+// As ISA_PUT, for a field given by its start and length.
+#define ISA_PUT_AT(start, len, v) ((((uint32_t) (v)) & ISA_MASK(len)) << (start))
+
+/*
+ENCODING CONSTANTS
+*/
+
+#define ISA_HALT_CODE 0x8a000000
+#define ISA_NOP_CODE 0xd503201f
+
+// Data processing
+#define ISA_DPI_BASE 0x10000000
+#define ISA_DPR_BASE 0x0a000000
+#define ISA_DPR_MUL_BASE 0x1b000000
+#define ISA_DPI_ARITHMETIC_OPI 0x2
+#define ISA_DPI_WIDEMOVE_OPI 0x5
+#define ISA_DPR_MULTIPLY_OPR 0x8
+#define ISA_HW_SHIFT 16 // bits per hw step in wide moves
+
+// Arithmetic opc
+#define ISA_ADD_OPC 0x0
+#define ISA_ADDS_OPC 0x1
+#define ISA_SUB_OPC 0x2
+#define ISA_SUBS_OPC 0x3
+
+// Logical opc
+#define ISA_AND_OPC 0x0
+#define ISA_ORR_OPC 0x1
+#define ISA_EOR_OPC 0x2
+#define ISA_ANDS_OPC 0x3
+
+// Wide move opc
+#define ISA_MOVN_OPC 0x0
+#define ISA_MOVZ_OPC 0x2
+#define ISA_MOVK_OPC 0x3
+
+// Shift types
+#define ISA_SHIFT_LSL 0x0
+#define ISA_SHIFT_LSR 0x1
+#define ISA_SHIFT_ASR 0x2
+#define ISA_SHIFT_ROR 0x3
+
+// Single data transfer
+#define ISA_SDT_BASE 0x38000000
+#define ISA_LOADLIT_BASE 0x18000000
+#define ISA_REG_OFFSET_BASE 0x00206800
+#define ISA_PRE_INDEX_BASE 0x00000c00
+#define ISA_POST_INDEX_BASE 0x00000400
+#define ISA_SIZE_BYTE 0x0
+#define ISA_SIZE_HALFWORD 0x1
+#define ISA_SIZE_WORD 0x2
+#define ISA_SIZE_DOUBLEWORD 0x3
+
+// Register pair data transfer
+#define ISA_PAIR_BASE 0x28000000
+#define ISA_PAIR_POST_INDEX 0x1
+#define ISA_PAIR_OFFSET 0x2
+#define ISA_PAIR_PRE_INDEX 0x3
+
+// Branch
+#define ISA_BR_UNCOND_BASE 0x14000000
+#define ISA_BR_REG_BASE 0xd61f0000
+#define ISA_BR_COND_BASE 0x54000000
+#define ISA_BR_LINK_BASE 0x94000000
+#define ISA_BR_RET_BASE 0xd65f0000
+#define ISA_CBZ_BASE 0x34000000
+#define ISA_LINK_REGISTER 30
+#define ISA_BR_TYPE_UNCOND 0x0
+#define ISA_BR_TYPE_CB 0x1 // compare and branch, 32 bit
+#define ISA_BR_TYPE_COND 0x2
+#define ISA_BR_TYPE_LINK 0x4
+#define ISA_BR_TYPE_CB_64 0x5 // compare and branch, 64 bit
+#define ISA_BR_TYPE_REG 0x6
+#define ISA_BR_REG_OPC_BLR 0x1 // register branch that links
+
+// Flags are held as a NZCV nibble.
+#define ISA_FLAG_N 0x8
+#define ISA_FLAG_Z 0x4
+#define ISA_FLAG_C 0x2
+#define ISA_FLAG_V 0x1
+#define ISA_NUM_FLAG_STATES 16
+
+// Truth table rows over all 16 NZCV states: bit f is set when the flag is set in state f.
+#define ISA_N_ROW 0xff00
+#define ISA_Z_ROW 0xf0f0
+#define ISA_C_ROW 0xcccc
+#define ISA_V_ROW 0xaaaa
+
+// Condition codes: X(suffix, code, truth table row over NZCV states)
+#define ISA_CONDITIONS(X) \
+    X(EQ, 0x0, ISA_Z_ROW) /* Equal */ \
+    X(NE, 0x1, ~ISA_Z_ROW) /* Not equal */ \
+    X(HS, 0x2, ISA_C_ROW) /* Unsigned higher or same (carry set) */ \
+    X(LO, 0x3, ~ISA_C_ROW) /* Unsigned lower (carry clear) */ \
+    X(MI, 0x4, ISA_N_ROW) /* Negative */ \
+    X(PL, 0x5, ~ISA_N_ROW) /* Positive or zero */ \
+    X(VS, 0x6, ISA_V_ROW) /* Overflow */ \
+    X(VC, 0x7, ~ISA_V_ROW) /* No overflow */ \
+    X(HI, 0x8, ISA_C_ROW & ~ISA_Z_ROW) /* Unsigned higher */ \
+    X(LS, 0x9, ~(ISA_C_ROW & ~ISA_Z_ROW)) /* Unsigned lower or same */ \
+    X(GE, 0xa, ~(ISA_N_ROW ^ ISA_V_ROW)) /* Signed greater or equal */ \
+    X(LT, 0xb, ISA_N_ROW ^ ISA_V_ROW) /* Signed less than */ \
+    X(GT, 0xc, ~ISA_Z_ROW & ~(ISA_N_ROW ^ ISA_V_ROW)) /* Signed greater than */ \
+    X(LE, 0xd, ISA_Z_ROW | (ISA_N_ROW ^ ISA_V_ROW)) /* Signed less than or equal */ \
+    X(AL, 0xe, 0xffff) /* Always */ \
+    X(NV, 0xf, 0xffff) /* Always (behaves as AL in AArch64) */
+
+#define ISA_CONDITION_ENUM(suffix, code, row) COND_##suffix = (code),
+enum { ISA_CONDITIONS(ISA_CONDITION_ENUM) };
+#undef ISA_CONDITION_ENUM
+
+/*
+INSTRUCTION CLASSES (emulator decode)
+*/
+
+// An instruction belongs to the first class whose op0 satisfies (op0 & mask) == value.
+// X(class, op0 mask, op0 value)
+#define ISA_CLASSES(X, op0) \
+    X(DATA_PROCESSING_IMMEDIATE, 0xe, 0x8, op0) \
+    X(DATA_PROCESSING_REGISTER, 0x7, 0x5, op0) \
+    X(SINGLE_DATA_TRANSFER, 0x5, 0x4, op0) \
+    X(BRANCH, 0xe, 0xa, op0)
+
+#define ISA_CLASS_TEST(class, mask, value, op0) (((op0) & (mask)) == (value)) ? class :
+
+// Class of an op0 value as a constant expression; fallback is used when no class matches.
+#define ISA_DECODE_CLASS(op0, fallback) (ISA_CLASSES(ISA_CLASS_TEST, op0) (fallback))
+
+/*
+MNEMONICS (assembler encode)
+*/
+
+// Every mnemonic is encoded by an encoder family, given the fixed bits that select it within the family.
+// X(mnemonic, name, family, fixed bits)
+#define ISA_INSTRUCTIONS(X) \
+    /* Arithmetic */ \
+    X("add", add, arithmeticInstructions, ISA_PUT(DP_OPC, ISA_ADD_OPC)) \
+    X("adds", adds, arithmeticInstructions, ISA_PUT(DP_OPC, ISA_ADDS_OPC)) \
+    X("sub", sub, arithmeticInstructions, ISA_PUT(DP_OPC, ISA_SUB_OPC)) \
+    X("subs", subs, arithmeticInstructions, ISA_PUT(DP_OPC, ISA_SUBS_OPC)) \
+    /* Logical */ \
+    X("and", and, logicalInstructions, ISA_PUT(DP_OPC, ISA_AND_OPC)) \
+    X("bic", bic, logicalInstructions, ISA_PUT(DP_OPC, ISA_AND_OPC) | ISA_PUT(DPR_N, 1)) \
+    X("orr", orr, logicalInstructions, ISA_PUT(DP_OPC, ISA_ORR_OPC)) \
+    X("orn", orn, logicalInstructions, ISA_PUT(DP_OPC, ISA_ORR_OPC) | ISA_PUT(DPR_N, 1)) \
+    X("eor", eor, logicalInstructions, ISA_PUT(DP_OPC, ISA_EOR_OPC)) \
+    X("eon", eon, logicalInstructions, ISA_PUT(DP_OPC, ISA_EOR_OPC) | ISA_PUT(DPR_N, 1)) \
+    X("ands", ands, logicalInstructions, ISA_PUT(DP_OPC, ISA_ANDS_OPC)) \
+    X("bics", bics, logicalInstructions, ISA_PUT(DP_OPC, ISA_ANDS_OPC) | ISA_PUT(DPR_N, 1)) \
+    /* Wide move */ \
+    X("movn", movn, wideMoveInstructions, ISA_PUT(DP_OPC, ISA_MOVN_OPC)) \
+    X("movz", movz, wideMoveInstructions, ISA_PUT(DP_OPC, ISA_MOVZ_OPC)) \
+    X("movk", movk, wideMoveInstructions, ISA_PUT(DP_OPC, ISA_MOVK_OPC)) \
+    /* Multiply */ \
+    X("madd", madd, multiplyInstructions, ISA_PUT(DPR_X, 0)) \
+    X("msub", msub, multiplyInstructions, ISA_PUT(DPR_X, 1)) \
+    /* Branch */ \
+    X("b", b, unconditionalBranch, ISA_BR_UNCOND_BASE) \
+    X("bl", bl, unconditionalBranch, ISA_BR_LINK_BASE) \
+    X("br", br, registerBranch, ISA_BR_REG_BASE) \
+    X("ret", ret, registerBranch, ISA_BR_RET_BASE) \
+    X("cbz", cbz, compareBranch, ISA_CBZ_BASE) \
+    X("cbnz", cbnz, compareBranch, ISA_CBZ_BASE | ISA_PUT(BR_CB_NONZERO, 1)) \
+    X("b.eq", beq, conditionalBranch, ISA_BR_COND_BASE | ISA_PUT(BR_COND, COND_EQ)) \
+    X("b.ne", bne, conditionalBranch, ISA_BR_COND_BASE | ISA_PUT(BR_COND, COND_NE)) \
+    X("b.hs", bhs, conditionalBranch, ISA_BR_COND_BASE | ISA_PUT(BR_COND, COND_HS)) \
+    X("b.cs", bcs, conditionalBranch, ISA_BR_COND_BASE | ISA_PUT(BR_COND, COND_HS)) \
+    X("b.lo", blo, conditionalBranch, ISA_BR_COND_BASE | ISA_PUT(BR_COND, COND_LO)) \
+    X("b.cc", bcc, conditionalBranch, ISA_BR_COND_BASE | ISA_PUT(BR_COND, COND_LO)) \
+    X("b.mi", bmi, conditionalBranch, ISA_BR_COND_BASE | ISA_PUT(BR_COND, COND_MI)) \
+    X("b.pl", bpl, conditionalBranch, ISA_BR_COND_BASE | ISA_PUT(BR_COND, COND_PL)) \
+    X("b.vs", bvs, conditionalBranch, ISA_BR_COND_BASE | ISA_PUT(BR_COND, COND_VS)) \
+    X("b.vc", bvc, conditionalBranch, ISA_BR_COND_BASE | ISA_PUT(BR_COND, COND_VC)) \
+    X("b.hi", bhi, conditionalBranch, ISA_BR_COND_BASE | ISA_PUT(BR_COND, COND_HI)) \
+    X("b.ls", bls, conditionalBranch, ISA_BR_COND_BASE | ISA_PUT(BR_COND, COND_LS)) \
+    X("b.ge", bge, conditionalBranch, ISA_BR_COND_BASE | ISA_PUT(BR_COND, COND_GE)) \
+    X("b.lt", blt, conditionalBranch, ISA_BR_COND_BASE | ISA_PUT(BR_COND, COND_LT)) \
+    X("b.gt", bgt, conditionalBranch, ISA_BR_COND_BASE | ISA_PUT(BR_COND, COND_GT)) \
+    X("b.le", ble, conditionalBranch, ISA_BR_COND_BASE | ISA_PUT(BR_COND, COND_LE)) \
+    X("b.al", bal, conditionalBranch, ISA_BR_COND_BASE | ISA_PUT(BR_COND, COND_AL)) \
+    X("b.nv", bnv, conditionalBranch, ISA_BR_COND_BASE | ISA_PUT(BR_COND, COND_NV)) \
+    /* Data transfer */ \
+    X("ldr", ldr, loadInstruction, ISA_PUT(SDT_L, 1)) \
+    X("str", str, dataTransferInstruction, ISA_PUT(SDT_L, 0)) \
+    X("ldrb", ldrb, narrowTransferInstruction, ISA_PUT(SDT_SIZE, ISA_SIZE_BYTE) | ISA_PUT(SDT_L, 1)) \
+    X("strb", strb, narrowTransferInstruction, ISA_PUT(SDT_SIZE, ISA_SIZE_BYTE) | ISA_PUT(SDT_L, 0)) \
+    X("ldrh", ldrh, narrowTransferInstruction, ISA_PUT(SDT_SIZE, ISA_SIZE_HALFWORD) | ISA_PUT(SDT_L, 1)) \
+    X("strh", strh, narrowTransferInstruction, ISA_PUT(SDT_SIZE, ISA_SIZE_HALFWORD) | ISA_PUT(SDT_L, 0)) \
+    X("ldp", ldp, pairTransferInstruction, ISA_PUT(SDT_L, 1)) \
+    X("stp", stp, pairTransferInstruction, ISA_PUT(SDT_L, 0)) \
+    /* Special instructions and directives */ \
+    X("nop", nop, fixedInstruction, ISA_NOP_CODE) \
+    X(".int", intdir, intDirective, 0)
+
+// Aliases re-order their operands, substituting the zero register, and encode as another mnemonic.
+// X(mnemonic, name, target name, operand rewrite)
+#define ISA_ALIASES(X) \
+    X("cmp", cmp, subs, ISA_ZR_RD) \
+    X("cmn", cmn, adds, ISA_ZR_RD) \
+    X("tst", tst, ands, ISA_ZR_RD) \
+    X("neg", neg, sub, ISA_ZR_RN) \
+    X("negs", negs, subs, ISA_ZR_RN) \
+    X("mov", mov, orr, ISA_ZR_RN) \
+    X("mvn", mvn, orn, ISA_ZR_RN) \
+    X("mul", mul, madd, ISA_ZR_RA) \
+    X("mneg", mneg, msub, ISA_ZR_RA)
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef OBJECT_H
+#define OBJECT_H
+
+#include <stdint.h>
+
+// Relocatable object written by assemble -c and combined into a flat binary by link.
+//
+// Layout, every part a whole number of 32-bit words in host (little endian) order:
+//   object_header
+//   numWords         assembled words, as in a flat binary starting at address 0
+//   numSymbols       object_symbol
+//   numRelocations   object_relocation
+//   stringsSize      bytes of NUL terminated symbol names, padded with NULs to a word
+//
+// Every label is listed. References between labels of the same object are PC-relative and are
+// already encoded; only references to labels the object does not define need a relocation.
+// link exports only the labels that some other object refers to, so local names may repeat.
+// Literal pool entries are 8-byte aligned relative to the object's start, so link places every
+// object at an 8-byte aligned address.
+
+#define OBJECT_MAGIC 0x4f4d5241 // "ARMO"
+#define OBJECT_VERSION 1
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t numWords;
+    uint32_t numSymbols;
+    uint32_t numRelocations;
+    uint32_t stringsSize; // in bytes
+} object_header;
+
+// Label defined by the object, or referenced by it and defined elsewhere.
+typedef struct {
+    uint32_t name;    // byte offset of the name in the strings
+    uint32_t address; // within the object; only meaningful if defined
+    uint32_t defined;
+} object_symbol;
+
+// The field at start/len of the word at address takes the word offset from address to symbol.
+typedef struct {
+    uint32_t address;
+    uint32_t symbol; // index into the symbols
+    uint8_t start;
+    uint8_t len;
+    uint16_t reserved;
+} object_relocation;
+
+#endif
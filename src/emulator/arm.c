@@ -0,0 +1,121 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include "defs.h"
+#include "utils.h"
+#include "branch.h"
+#include "data_processing.h"
+#include "data_transfer.h"
+#include "loops.h"
+
+// Non-instruction data and NOP are ignored.
+static bool skip(ARM* arm, int instruction) {
+    return true;
+}
+
+// Execution function for each instruction type; each returns false if the instruction faulted.
+static bool (*const execute[])(ARM* arm, int instruction) = {
+    [DATA_PROCESSING_IMMEDIATE] = &dataProcessingImmediate,
+    [DATA_PROCESSING_REGISTER] = &dataProcessingRegister,
+    [SINGLE_DATA_TRANSFER] = &singleDataTransfer,
+    [BRANCH] = &branch,
+    [NOP] = &skip,
+    [DATA] = &skip
+};
+
+// Resets registers, PSTATE and PC; memory is left untouched.
+static void resetState(ARM* arm) {
+    memset(arm->registers, 0, sizeof(arm->registers));
+    arm->pstate = ISA_FLAG_Z;
+    arm->pc = 0;
+}
+
+// Allocates an ARM processor in its default state.
+ARM* newARM(void) {
+    // calloc gives zeroed memory and a clean dirty page map.
+    ARM* arm = calloc(1, sizeof(ARM));
+    assert(arm != NULL);
+    resetState(arm);
+    return arm;
+}
+
+// Returns an ARM processor to its default state, zeroing only memory pages written since the last reset.
+void resetARM(ARM* arm) {
+    resetState(arm);
+
+    for (int word = 0; word < NUM_OF_PAGES / PAGES_PER_DIRTY_WORD; word++) {
+        uint64_t dirty = arm->dirtyPages[word];
+        while (dirty != 0) {
+            int page = word * PAGES_PER_DIRTY_WORD + __builtin_ctzll(dirty);
+            memset(&arm->memory[page * MEMORY_PAGE_SIZE], 0, MEMORY_PAGE_SIZE);
+            // Clear lowest set bit.
+            dirty &= dirty - 1;
+        }
+        arm->dirtyPages[word] = 0;
+    }
+}
+
+// Records that size bytes starting at address have been written.
+void markDirty(ARM* arm, uint64_t address, uint64_t size) {
+    if (size == 0) {
+        return;
+    }
+    uint64_t first = address / MEMORY_PAGE_SIZE;
+    uint64_t last = (address + size - 1) / MEMORY_PAGE_SIZE;
+    for (uint64_t page = first; page <= last && page < NUM_OF_PAGES; page++) {
+        arm->dirtyPages[page / PAGES_PER_DIRTY_WORD] |= (uint64_t) 1 << (page % PAGES_PER_DIRTY_WORD);
+    }
+}
+
+// Hashes an instruction address into coverage map index bits.
+static uint32_t coverageLocation(uint64_t address) {
+    return (uint32_t) (((address / INSTRUCTION_SIZE) * 0x9e3779b1u) >> 8);
+}
+
+// Adds hits for the branch edge from -> to, as if it had been taken that many times.
+void recordEdgeHits(ARM* arm, uint64_t from, uint64_t to, uint64_t hits) {
+    // Shifting one side keeps A -> B and B -> A distinct.
+    uint32_t edge = (coverageLocation(from) ^ (coverageLocation(to) >> 1)) & (COVERAGE_MAP_SIZE - 1);
+    // Counters wrap, as hits one at a time would.
+    arm->coverage[edge] += (uint8_t) hits;
+}
+
+// Adds a hit for the branch edge from -> to in the coverage map.
+void recordEdge(ARM* arm, uint64_t from, uint64_t to) {
+    recordEdgeHits(arm, from, to, 1);
+}
+
+// Runs the fetch-decode-execute cycle from the current PC until halt, a fault,
+// or budget instructions have been executed.
+RUN_STATUS runARM(ARM* arm, uint64_t budget) {
+    for (uint64_t executed = 0; executed < budget; executed++) {
+        // Check if address is in memory range.
+        if (arm->pc > MAX_MEMORY_SIZE - INSTRUCTION_SIZE) {
+            return RUN_PC_OUT_OF_RANGE;
+        }
+
+        // Fetch and decode instruction.
+        int instruction = getWord(&arm->memory[arm->pc]);
+        INSTRUCTION_TYPE type = getInstructionType(instruction);
+
+        // A copy or fill loop starting here runs all but its last iteration at once; the rest is interpreted.
+        if (type == SINGLE_DATA_TRANSFER && !arm->interpretLoops) {
+            executed += skipLoop(arm, instruction, budget - executed);
+        }
+
+        if (arm->profile != NULL) {
+            arm->profile[arm->pc / INSTRUCTION_SIZE]++;
+        }
+
+        if (type == HALT) {
+            return RUN_HALTED;
+        }
+        if (!execute[type](arm, instruction)) {
+            return RUN_FAULT;
+        }
+
+        arm->pc += INSTRUCTION_SIZE;
+    }
+    return RUN_OUT_OF_BUDGET;
+}
@@ -0,0 +1,20 @@
+#include "defs.h"
+
+// Allocates an ARM processor in its default state.
+ARM* newARM(void);
+
+// Returns an ARM processor to its default state, zeroing only memory pages written since the last reset.
+void resetARM(ARM* arm);
+
+// Records that size bytes starting at address have been written.
+void markDirty(ARM* arm, uint64_t address, uint64_t size);
+
+// Adds a hit for the branch edge from -> to in the coverage map.
+void recordEdge(ARM* arm, uint64_t from, uint64_t to);
+
+// Adds hits for the branch edge from -> to, as if it had been taken that many times.
+void recordEdgeHits(ARM* arm, uint64_t from, uint64_t to, uint64_t hits);
+
+// Runs the fetch-decode-execute cycle from the current PC until halt, a fault,
+// or budget instructions have been executed.
+RUN_STATUS runARM(ARM* arm, uint64_t budget);
@@ -1,19 +1,25 @@
 #include <assert.h>
 #include "defs.h"
 #include "utils.h"
+#include "arm.h"
 #include <stdio.h>
 
 // Gets branch type from instruction
 static BRANCH_TYPE getBranchType(int instruction) {
     // Get bits that determine branch type
-    int determiningbits = getBitsAt(instruction, BR_DET_BITS_START, BR_DET_BITS_LEN);
+    int determiningbits = ISA_GET(BR_TYPE, instruction);
 
     switch (determiningbits) {
-        case BR_DET_BITS_UNCOND:
+        case ISA_BR_TYPE_UNCOND:
             return UNCONDITIONAL;
-        case BR_DET_BITS_REG:
+        case ISA_BR_TYPE_LINK:
+            return LINK;
+        case ISA_BR_TYPE_CB:
+        case ISA_BR_TYPE_CB_64:
+            return COMPARE;
+        case ISA_BR_TYPE_REG:
             return REGISTER;
-        case BR_DET_BITS_COND:
+        case ISA_BR_TYPE_COND:
             return CONDITIONAL;
         default:
             // Not valid branch.
@@ -21,69 +27,73 @@ static BRANCH_TYPE getBranchType(int instruction) {
     }
 }
 
+// Row cond has bit f set when the condition holds for NZCV state f.
+static const uint16_t conditionTable[ISA_NUM_FLAG_STATES] = {
+#define CONDITION_ROW(suffix, code, row) [code] = (uint16_t) (row),
+    ISA_CONDITIONS(CONDITION_ROW)
+#undef CONDITION_ROW
+};
+
 // Determine if ARM PSTATE satisfies cond
 static bool conditionCheck(int cond, ARM* arm) {
-    int n = arm->pstate.N;
-    int z = arm->pstate.Z;
-    int v = arm->pstate.V;
-
-    switch (cond) {
-        // EQ (Equal)
-        case BR_EQ:
-            return (z == 1);
-        // NE (Not Equal)
-        case BR_NE:
-            return (z == 0);
-        // GE (Signed greater or equal)
-        case BR_GE:
-            return (n == 1);
-        // LT (Signed less than)
-        case BR_LT:
-            return (n != 1);
-        // GT (Signed greater than)
-        case BR_GT:
-            return (z == 0 && n == v);
-        // LE (Signed less than or equal)
-        case BR_LE:
-            return (!(z == 0 && n == v));
-        // AL (always)
-        case BR_AL:
-            return 1;
-        // Condition not of permitted type
-        default:
-            return 0;
-    }
+    return (conditionTable[cond] >> arm->pstate) & 1;
 }
 
 
-// Execute branch instruction
-void branch(ARM* arm, int instruction) {
+// Execute branch instruction; returns false if it faulted.
+bool branch(ARM* arm, int instruction) {
+    uint64_t from = arm->pc;
 
     // Get type of branch instruction
     BRANCH_TYPE type = getBranchType(instruction);
 
     switch (type) {
         case UNCONDITIONAL: {
-            int64_t simm26 = extendBits(getBitsAt(instruction, BR_SIMM26_START, SIMM26_LEN), SIMM26_LEN);
+            int64_t simm26 = ISA_GET_SIGNED(BR_SIMM26, instruction);
             int64_t offset = simm26 * BYTES_IN_WORD;
             // Branch to address encoded by literal
             arm->pc += offset;
             arm->pc -= INSTRUCTION_SIZE;
             break;
         }
+        case LINK: {
+            int64_t simm26 = ISA_GET_SIGNED(BR_SIMM26, instruction);
+            // Return address is the next instruction
+            arm->registers[ISA_LINK_REGISTER] = arm->pc + INSTRUCTION_SIZE;
+            arm->pc += simm26 * BYTES_IN_WORD;
+            arm->pc -= INSTRUCTION_SIZE;
+            break;
+        }
         case REGISTER: {
             // Determining encoding of register Xn
-            int xn = getBitsAt(instruction, BR_XN_START, REG_INDEX_SIZE);
+            int xn = ISA_GET(BR_XN, instruction);
             // Check if xn refers to an exisiting register
             assert(xn >= 0 && xn < NUM_OF_REGISTERS);
-            // Branch to address stored in Xn
-            arm->pc = arm->registers[xn];
+            // Branch to address stored in Xn (br, ret); blr also links
+            uint64_t target = arm->registers[xn];
+            if (ISA_GET(BR_REG_OPC, instruction) == ISA_BR_REG_OPC_BLR) {
+                arm->registers[ISA_LINK_REGISTER] = arm->pc + INSTRUCTION_SIZE;
+            }
+            arm->pc = target;
             arm->pc -= INSTRUCTION_SIZE;
             break;
         }
+        case COMPARE: {
+            int rt = ISA_GET(BR_RT, instruction);
+            uint64_t value = arm->registers[rt];
+            if (!ISA_GET(BR_CB_SF, instruction)) {
+                value &= WREGISTER_MASK;
+            }
+            // cbz branches on zero, cbnz on non-zero
+            if ((value != 0) == ISA_GET(BR_CB_NONZERO, instruction)) {
+                arm->pc += ISA_GET_SIGNED(BR_SIMM19, instruction) * BYTES_IN_WORD;
+                arm->pc -= INSTRUCTION_SIZE;
+            }
+            break;
+        }
         case CONDITIONAL: {
-            int64_t simm19 = extendBits(getBitsAt(instruction, BR_SIMM19_START, SIMM19_LEN), SIMM19_LEN);
-            int cond = getBitsAt(instruction, BR_COND_START, BR_COND_LEN);
+            int64_t simm19 = ISA_GET_SIGNED(BR_SIMM19, instruction);
+            int cond = ISA_GET(BR_COND, instruction);
             if (conditionCheck(cond, arm)) {
                 int64_t offset = simm19 * BYTES_IN_WORD;
                 // Branch to address encoded by literal
@@ -93,4 +103,10 @@ void branch(ARM* arm, int instruction) {
             break;
         }
     }
+
+    // Record the edge taken (conditional fall-through included) for coverage-guided fuzzing.
+    if (arm->coverage != NULL) {
+        recordEdge(arm, from, arm->pc + INSTRUCTION_SIZE);
+    }
+    return true;
 }
@@ -1,4 +1,4 @@
 #include "defs.h"
 
-// Execute branch instruction
-void branch(ARM* arm, int instruction);
+// Execute branch instruction; returns false if it faulted.
+bool branch(ARM* arm, int instruction);
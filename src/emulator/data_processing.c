@@ -19,7 +19,7 @@ static void movn(ARM* arm, int rd, uint64_t op, int hw) {
 }
 
 static void movk(ARM* arm, int rd, uint64_t op, int hw) {
-    arm->registers[rd] = setBitsTo(arm->registers[rd], (hw + 1) * DPI_MOVK_OFFSET, op, IMM16_LEN);
+    arm->registers[rd] = setBitsTo(arm->registers[rd], (hw + 1) * DPI_MOVK_OFFSET, op, DPI_IMM16_LEN);
 }
 
 static uint64_t add(ARM* arm, int rd, int rn, uint64_t op2, int sf) {
@@ -34,53 +34,42 @@ static uint64_t sub(ARM* arm, int rd, int rn, uint64_t op2, int sf) {
     return r;
 }
 
-static uint64_t adds(ARM* arm, int rd, int rn, uint64_t u_op2, int sf) {
-    // If rd is the zero register then we compute result without changing memory.
-    uint64_t u_rncontent = arm->registers[rn];
-    uint64_t u_r = (rd == ZR_INDEX) ? u_rncontent + u_op2 : add(arm, rd, rn, u_op2, sf);
+// Result and sign bit masks for the operation width.
+static uint64_t widthMask(int sf) {
+    return sf ? UINT64_MAX : WREGISTER_MASK;
+}
 
-    int64_t rncontent = u_rncontent;
-    int64_t r = u_r;
-    int64_t op2 = op2;
+static uint64_t signMask(int sf) {
+    return sf ? SUBS_64BIT_LMASK : SUBS_32BIT_LMASK;
+}
 
-    bool sign_1 = (sf ? rncontent < 0 : ((int32_t) (u_rncontent & WREGISTER_MASK) < 0));
-    bool sign_2 = (sf ? op2 < 0 : ((int32_t) (u_op2 & WREGISTER_MASK)) < 0);
-    bool sign_r = (sf ? r < 0 : ((int32_t) (u_r & WREGISTER_MASK)) < 0);
+static uint64_t adds(ARM* arm, int rd, int rn, uint64_t op2, int sf) {
+    // If rd is the zero register then we compute result without changing memory.
+    uint64_t rncontent = arm->registers[rn] & widthMask(sf);
+    op2 &= widthMask(sf);
+    uint64_t r = ((rd == ZR_INDEX) ? rncontent + op2 : add(arm, rd, rn, op2, sf)) & widthMask(sf);
 
-    // Sets flags for PSTATE
-    arm->pstate.Z = (r == 0);
-    // Check negative as 32 or 64 bit
-    arm->pstate.N = sign_r;
     // Unsigned overflow if carry bit is produced
-    arm->pstate.C = sf ? u_r < u_rncontent : u_r >= (1UL << 32);
-    // Signed overflow/underflow if signs of operand are diferent from result
-    arm->pstate.V = (!sign_1 && !sign_2 && sign_r) || (sign_1 && sign_2 && !sign_r);
+    bool c = r < rncontent;
+    // Signed overflow if both operands have a sign different from the result
+    bool v = ((rncontent ^ r) & (op2 ^ r) & signMask(sf)) != 0;
+
+    arm->pstate = PSTATE_NZCV((r & signMask(sf)) != 0, r == 0, c, v);
     return EXIT_SUCCESS;
 }
 
 static uint64_t subs(ARM* arm, int rd, int rn, uint64_t op2, int sf) {
     // If rd is the zero register then we compute result without changing memory.
-    uint64_t rncontent = arm->registers[rn];
-    uint64_t r = (rd == ZR_INDEX) ? arm->registers[rn] - op2 : sub(arm, rd, rn, op2, sf);
-
-    bool sign_1 = (sf ? (uint64_t) rncontent < 0 : ((int32_t) (rncontent & WREGISTER_MASK) < 0));
-    bool sign_2 = (sf ? (uint64_t) op2 < 0 : ((int32_t) (op2 & WREGISTER_MASK)) < 0);
-    bool sign_r = (sf ? (uint64_t) r < 0 : ((int32_t) (r & WREGISTER_MASK)) < 0);
-
-    // Sets flags for PSTATE
-    arm->pstate.Z = (r == 0);
-    // Check negative as 32 or 64 bit
-    arm->pstate.N = sf ? (r & (1UL << 63)) : (r & (1UL << 31));
-    // Unsigned overflow if subtraction produced a borrow
-    if (sf) {
-        arm->pstate.C = ((int64_t) (op2 & SUBS_64BIT_UMASK)) - (op2 & SUBS_64BIT_LMASK)
-            <= ((int64_t) (rncontent & SUBS_64BIT_UMASK)) - (rncontent & SUBS_64BIT_LMASK);
-    } else {
-        arm->pstate.C = (op2 & SUBS_32BIT_UMASK) - (op2 & SUBS_32BIT_LMASK) <= (rncontent & SUBS_32BIT_UMASK) - (rncontent & SUBS_32BIT_LMASK);
-    }
-    // Signed overflow/underflow if signs of operand are diferent from result
-    arm->pstate.V = (!sign_1 && sign_2 && sign_r) || (sign_1 && !sign_2 && !sign_r);
+    uint64_t rncontent = arm->registers[rn] & widthMask(sf);
+    op2 &= widthMask(sf);
+    uint64_t r = ((rd == ZR_INDEX) ? rncontent - op2 : sub(arm, rd, rn, op2, sf)) & widthMask(sf);
+
+    // Carry is set if subtraction did not produce a borrow
+    bool c = rncontent >= op2;
+    // Signed overflow if operands have different signs and the result's sign differs from rn
+    bool v = ((rncontent ^ op2) & (rncontent ^ r) & signMask(sf)) != 0;
 
+    arm->pstate = PSTATE_NZCV((r & signMask(sf)) != 0, r == 0, c, v);
     return EXIT_SUCCESS;
 }
 
@@ -103,13 +92,8 @@ static uint64_t eor(ARM* arm, int rd, int rn, uint64_t op2, int sf) {
 static uint64_t ands(ARM* arm, int rd, int rn, uint64_t op2, int sf) {
     int64_t r = (rd == ZR_INDEX) ? arm->registers[rn] & op2 : and(arm, rd, rn, op2, sf);
 
-    // Sets flags for PSTATE
-    arm->pstate.Z = (r == 0);
-    // Check negative as 32 or 64 bit
-    arm->pstate.N = sf ? (r < 0) : ((int32_t) r < 0);
-    // C and V are set to 0 after logical operations.
-    arm->pstate.C = 0;
-    arm->pstate.V = 0;
+    // Sets flags for PSTATE; C and V are set to 0 after logical operations.
+    arm->pstate = PSTATE_NZCV(sf ? (r < 0) : ((int32_t) r < 0), r == 0, 0, 0);
     return EXIT_SUCCESS;
 }
 
@@ -154,20 +138,19 @@ static uint64_t (*shiftRm[4])(uint64_t rm, uint32_t imm6, bool sf) = {
 Main functions
 */
 
-void dataProcessingImmediate(ARM* arm, int instruction) {
-    bool sf = getBitAt(instruction, DPI_SFBIT);
-    int opc = getBitsAt(instruction, DPI_OPC_START, DPI_OPC_LEN);
-    int opi = getBitsAt(instruction, DPI_OPI_START, DPI_OPI_LEN);
-    int rd = getBitsAt(instruction, DPI_RD_START, REG_INDEX_SIZE);
-    fprintf(stderr, "%d", opc);
+bool dataProcessingImmediate(ARM* arm, int instruction) {
+    bool sf = ISA_GET(DP_SF, instruction);
+    int opc = ISA_GET(DP_OPC, instruction);
+    int opi = ISA_GET(DPI_OPI, instruction);
+    int rd = ISA_GET(DP_RD, instruction);
 
     switch (opi) {
 
         // Arithmetic
-        case DPI_ARITHMETIC_OPI: {
-            bool sh = getBitAt(instruction, DPI_SHBIT);
-            uint64_t imm12 = getBitsAt(instruction, DPI_IMM12_START, IMM12_LEN);
-            int rn = getBitsAt(instruction, DPI_RN_START, REG_INDEX_SIZE);
+        case ISA_DPI_ARITHMETIC_OPI: {
+            bool sh = ISA_GET(DPI_SH, instruction);
+            uint64_t imm12 = ISA_GET(DPI_IMM12, instruction);
+            int rn = ISA_GET(DP_RN, instruction);
 
             // Shift imm12 by 12 if shift bit is given.
             if (sh) {
@@ -198,13 +181,18 @@ void dataProcessingImmediate(ARM* arm, int instruction) {
         }
 
         // Wide Move
-        case DPI_WIDEMOVE_OPI: {
-            int hw = getBitsAt(instruction, DPI_HW_START, DPI_HW_SIZE);
-            uint64_t imm16 = getBitsAt(instruction, DPI_IMM16_START, IMM16_LEN);
+        case ISA_DPI_WIDEMOVE_OPI: {
+            int hw = ISA_GET(DPI_HW, instruction);
+            uint64_t imm16 = ISA_GET(DPI_IMM16, instruction);
+
+            // Opc 0b01 is unallocated for wide moves.
+            if (wideMove[opc] == NULL) {
+                return false;
+            }
 
             // For movk don't shift imm16.
-            if (opc != DPI_MOVK_OPC) {
-                imm16 <<= (hw * DPI_SHIFT_VALUE);
+            if (opc != ISA_MOVK_OPC) {
+                imm16 <<= (hw * ISA_HW_SHIFT);
             }
 
             // Read rd as 32 bit register if sf is not given.
@@ -227,20 +215,21 @@ void dataProcessingImmediate(ARM* arm, int instruction) {
     if (!sf) {
         arm->registers[rd] &= WREGISTER_MASK;
     }
+    return true;
 }
 
 // Execute data processing register instructions.
-void dataProcessingRegister(ARM* arm, int instruction) {
-    bool sf = getBitAt(instruction, DPR_SFBIT_POS);
-    int rd = getBitsAt(instruction, DPR_RD_START, REG_INDEX_SIZE);
-    int rm = getBitsAt(instruction, DPR_RM_START, REG_INDEX_SIZE);
-    int rn = getBitsAt(instruction, DPR_RN_START, REG_INDEX_SIZE);
-    bool m = getBitAt(instruction, DPR_MBIT_POS);
+bool dataProcessingRegister(ARM* arm, int instruction) {
+    bool sf = ISA_GET(DP_SF, instruction);
+    int rd = ISA_GET(DP_RD, instruction);
+    int rm = ISA_GET(DPR_RM, instruction);
+    int rn = ISA_GET(DP_RN, instruction);
+    bool m = ISA_GET(DPR_M, instruction);
 
     // Multiply; m determines whether its multiply or arithemtic/logical
     if (m) {
-        int ra = getBitsAt(instruction, DPR_RA_START, REG_INDEX_SIZE);
-        bool x = getBitAt(instruction, DPR_XBIT_POS);
+        int ra = ISA_GET(DPR_RA, instruction);
+        bool x = ISA_GET(DPR_X, instruction);
 
         // If sf is not given, read registers as 32 bit; all but rd to be restored later.
         uint64_t rntemp;
@@ -277,11 +266,11 @@ void dataProcessingRegister(ARM* arm, int instruction) {
 
     // Arithemtic and Logical
     else {
-        int shift = getBitsAt(instruction, DPR_SHIFT_START, DPR_SHIFT_LEN);
-        bool n = getBitAt(instruction, DPR_NBIT_POS);
-        int opc = getBitsAt(instruction, DPR_OPC_START, DPR_OPC_LEN);
-        uint64_t imm6 = getBitsAt(instruction, DPR_IMM6_START, IMM6_LEN);
-        bool isArithmetic = getBitAt(instruction, DPR_ARITHMETICBIT_POS);
+        int shift = ISA_GET(DPR_SHIFT, instruction);
+        bool n = ISA_GET(DPR_N, instruction);
+        int opc = ISA_GET(DP_OPC, instruction);
+        uint64_t imm6 = ISA_GET(DPR_IMM6, instruction);
+        bool isArithmetic = ISA_GET(DPR_ARITHMETIC, instruction);
 
         // If sf is not given, read registers as 32 bit; all but rd to be restored later.
         uint64_t rntemp;
@@ -327,4 +316,5 @@ void dataProcessingRegister(ARM* arm, int instruction) {
     if (!sf) {
         arm->registers[rd] &= WREGISTER_MASK;
     }
+    return true;
 }
@@ -1,7 +1,7 @@
 #include "defs.h"
 
-// Execute data processing immediate functions.
-void dataProcessingImmediate(ARM* arm, int instruction);
+// Execute data processing immediate functions; returns false if it faulted.
+bool dataProcessingImmediate(ARM* arm, int instruction);
 
-// Execute data processing register instructions.
-void dataProcessingRegister(ARM* arm, int instruction);
+// Execute data processing register instructions; returns false if it faulted.
+bool dataProcessingRegister(ARM* arm, int instruction);
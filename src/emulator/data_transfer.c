@@ -2,22 +2,23 @@
 #include <assert.h>
 #include "defs.h"
 #include "utils.h"
+#include "arm.h"
 
 static TRANSFER_TYPE getTransferType(int instruction) {
-    bool u = getBitAt(instruction, SDT_UBIT_POS);
-    bool i = getBitAt(instruction, SDT_IBIT_POS);
+    bool u = ISA_GET(SDT_U, instruction);
+    bool i = ISA_GET(SDT_I, instruction);
 
     // If u is given then unsigned offset.
     if (u) {
         return UNSIGNED_OFFSET;
     }
 
-    if (getBitAt(instruction, SDT_LOADLITERAL_BIT) == 0) {
+    if (ISA_GET(SDT_NOT_LITERAL, instruction) == 0) {
         return LITERAL_ADDRESS;
      }
 
     // If the first bit is 0 then register offset, else pre/post index.
-    if (getBitAt(instruction, SDT_REGISTEROFFSET_BIT) == 0) {
+    if (ISA_GET(SDT_INDEXED, instruction) == 0) {
         return REGISTER_OFFSET;
     }
 
@@ -29,68 +30,114 @@ static TRANSFER_TYPE getTransferType(int instruction) {
     return POST_INDEX;
 }
 
-// Execute single data transfer.
-void singleDataTransfer(ARM* arm, int instruction) {
-    bool l = getBitAt(instruction, SDT_LBIT_POS);
-    bool sf = getBitAt(instruction, SDT_SFBIT_POS);
-    int rt = getBitsAt(instruction, SDT_RT_START, REG_INDEX_SIZE);
-    int xn = getBitsAt(instruction, SDT_XN_START, REG_INDEX_SIZE);
+// Execute register pair transfer; returns false if it faulted.
+static bool pairDataTransfer(ARM* arm, int instruction) {
+    bool l = ISA_GET(SDT_L, instruction);
+    int size = ISA_GET(PAIR_SF, instruction) ? BYTES_IN_64BIT : BYTES_IN_32BIT;
+    int rt = ISA_GET(SDT_RT, instruction);
+    int rt2 = ISA_GET(PAIR_RT2, instruction);
+    int xn = ISA_GET(SDT_XN, instruction);
+    int64_t offset = ISA_GET_SIGNED(PAIR_IMM7, instruction) * size;
+    uint64_t address;
+
+    switch (ISA_GET(PAIR_MODE, instruction)) {
+        case ISA_PAIR_POST_INDEX:
+            address = arm->registers[xn];
+            arm->registers[xn] += offset;
+            break;
+        case ISA_PAIR_OFFSET:
+            address = arm->registers[xn] + offset;
+            break;
+        case ISA_PAIR_PRE_INDEX:
+            arm->registers[xn] += offset;
+            address = arm->registers[xn];
+            break;
+        default:
+            // Unallocated addressing mode.
+            return false;
+    }
+
+    // Accesses that do not fit in memory fault.
+    if (address > MAX_MEMORY_SIZE - 2 * size) {
+        return false;
+    }
+
+    if (l) {
+        arm->registers[rt] = getBytes(&arm->memory[address], size);
+        arm->registers[rt2] = getBytes(&arm->memory[address + size], size);
+    } else {
+        markDirty(arm, address, 2 * size);
+        setBytes(&arm->memory[address], arm->registers[rt], size);
+        setBytes(&arm->memory[address + size], arm->registers[rt2], size);
+    }
+    return true;
+}
+
+// Execute single data transfer; returns false if it faulted.
+bool singleDataTransfer(ARM* arm, int instruction) {
+    // Register pairs share the instruction class.
+    if (!ISA_GET(SDT_SINGLE, instruction)) {
+        return pairDataTransfer(arm, instruction);
+    }
+
+    bool l = ISA_GET(SDT_L, instruction);
+    int rt = ISA_GET(SDT_RT, instruction);
+    int xn = ISA_GET(SDT_XN, instruction);
     uint64_t address;
 
     TRANSFER_TYPE type = getTransferType(instruction);
 
+    // Load literals are word or double word; other transfers encode their size.
+    int size;
+    if (type == LITERAL_ADDRESS) {
+        size = ISA_GET(SDT_SF, instruction) ? BYTES_IN_64BIT : BYTES_IN_32BIT;
+    } else {
+        size = 1 << ISA_GET(SDT_SIZE, instruction);
+    }
+
     switch (type) {
         case UNSIGNED_OFFSET: {
-            uint64_t imm12 = getBitsAt(instruction, SDT_IMM12_START, IMM12_LEN);
-            int scale = sf ? 8 : 4;
-            address = arm->registers[xn] + (imm12 * scale);
+            uint64_t imm12 = ISA_GET(SDT_IMM12, instruction);
+            address = arm->registers[xn] + (imm12 * size);
             break;
         }
-
         case PRE_INDEX: {
-            int64_t simm9 = getBitsAt(instruction, SDT_SIMM9_START, SIMM9_LEN);
+            int64_t simm9 = ISA_GET_SIGNED(SDT_SIMM9, instruction);
             arm->registers[xn] += simm9;
             address = arm->registers[xn];
             break;
         }
         case POST_INDEX: {
-            int64_t simm9 = extendBits(getBitsAt(instruction, SDT_SIMM9_START, SIMM9_LEN), SIMM9_LEN);
+            int64_t simm9 = ISA_GET_SIGNED(SDT_SIMM9, instruction);
             address = arm->registers[xn];
             arm->registers[xn] += simm9;
             break;
         }
         case REGISTER_OFFSET: {
-            int xm = getBitsAt(instruction, SDT_XM_START, REG_INDEX_SIZE);
+            int xm = ISA_GET(SDT_XM, instruction);
             address = arm->registers[xn] + arm->registers[xm];
             break;
         }
         case LITERAL_ADDRESS:{
-            int64_t simm19 = extendBits(getBitsAt(instruction, SDT_SIMM19_START, SIMM19_LEN), SIMM19_LEN);
+            int64_t simm19 = ISA_GET_SIGNED(SDT_SIMM19, instruction);
             address = arm->pc + (simm19 * BYTES_IN_WORD);
             break;
         }
     }
 
+    // Accesses that do not fit in memory fault.
+    if (address > MAX_MEMORY_SIZE - size) {
+        return false;
+    }
+
     // If load bit is given then load, else store.
     if (l || type == LITERAL_ADDRESS) {
-        // Load
-        assert(address < MAX_MEMORY_SIZE);
-        if (sf) {
-            // In 64 bit load double word at address memory into register.
-            arm->registers[rt] = getDoubleWord(&arm->memory[address]);
-        } else {
-            // In 32 bit load word at address memory into register.
-            arm->registers[rt] = getWord(&arm->memory[address]);
-        }
+        // Load size bytes at address, zero extended into register.
+        arm->registers[rt] = getBytes(&arm->memory[address], size);
     } else {
-        // Store
-        uint64_t rtcontent = arm->registers[rt];
-        int storesize = sf ? BYTES_IN_64BIT : BYTES_IN_32BIT;
-        // Store by shifting 1 byte of register's content at a time into memory.
-        // Since we store least significant bit first, we mantain little endian storage.
-        assert(address + storesize < MAX_MEMORY_SIZE);
-        for (int i = 0; i < storesize; i++) {
-            arm->memory[address + i] = (rtcontent >> (SIZE_OF_BYTE * i)) & BYTE_MASK;
-        }
+        // Store low size bytes of register; least significant byte first mantains little endian storage.
+        markDirty(arm, address, size);
+        setBytes(&arm->memory[address], arm->registers[rt], size);
     }
+    return true;
 }
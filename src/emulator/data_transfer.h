@@ -1,4 +1,4 @@
 #include "defs.h"
 
-// Execute single data transfer.
-void singleDataTransfer(ARM* arm, int instruction);
+// Execute single data transfer; returns false if it faulted.
+bool singleDataTransfer(ARM* arm, int instruction);
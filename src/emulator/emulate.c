@@ -3,79 +3,134 @@
 #include <string.h>
 #include <stdio.h>
 #include <assert.h>
+#include <unistd.h>
 #include "utils.h"
-#include "branch.h"
-#include "data_processing.h"
-#include "data_transfer.h"
+#include "arm.h"
+#include "symbol_map.h"
 
-int main(int argc, char **argv) {
-
-    // Check if binary file provided.
-    if (argc < 2) {
-        fprintf(stderr, "emulate: no binary file provided.\n");
-        fprintf(stderr, "%i args", argc);
-        for (int i = 0; i < argc; i++) {
-            fputs(argv[i], stderr);
-            fputs(" ", stderr);
-        }
-        exit(EXIT_FAILURE);
-    }
+#define DEFAULT_OUTPUT "output.out"
+#define NUM_HOT_SPOTS 10 // instructions listed by -p
+#define DESCRIPTION_SIZE 256
+#define LOOPS_ENV "EMULATE_LOOPS" // set to "interpret" to run copy and fill loops one instruction at a time
 
-    // Initialise ARM to default state.
-    ARM arm = {
-        .registers = {0},
-        .memory = {0},
-        .pstate = (PSTATE) {.N = false, .Z = true, .C = false, .V = false},
-        .pc = 0
-    };
+static void usage(void) {
+    fprintf(stderr, "emulate: ./emulate [-n <runs>] [-m <symbol_map>] [-p] <file_in> [<file_out>] [<file_in> <file_out>]...\n");
+    exit(EXIT_FAILURE);
+}
 
-    // Load instructions into memory.
-    loadBinary(arm.memory, argv[1]);
+// Writes address into buffer, as label+offset and source line when a symbol map is loaded.
+static char* describe(symbol_map* map, uint64_t address, char* buffer) {
+    if (map != NULL) {
+        symbolize(map, address, buffer, DESCRIPTION_SIZE);
+    } else {
+        snprintf(buffer, DESCRIPTION_SIZE, "0x%lx", address);
+    }
+    return buffer;
+}
 
-    // Fetch-Decode-Execute Cycle
-    for (;;) {
-        // Check if address is in memory range.
-        if (arm.pc < 0 || arm.pc >= MAX_MEMORY_SIZE) {
-            fprintf(
-                stderr,
-                "the PC is: %lu which is out of range \n",
-                arm.pc);
-            exit(EXIT_FAILURE);
+// Prints the most executed instructions of the profile, then clears it for the next binary.
+static void printHotSpots(uint64_t* profile, symbol_map* map, char* binary) {
+    // Indices of the hottest addresses so far, hottest first.
+    uint32_t hot[NUM_HOT_SPOTS];
+    int numHot = 0;
+    for (uint32_t i = 0; i < PROFILE_SIZE; i++) {
+        if (profile[i] == 0 || (numHot == NUM_HOT_SPOTS && profile[i] <= profile[hot[numHot - 1]])) {
+            continue;
+        }
+        int j = numHot < NUM_HOT_SPOTS ? numHot++ : numHot - 1;
+        for (; j > 0 && profile[hot[j - 1]] < profile[i]; j--) {
+            hot[j] = hot[j - 1];
         }
+        hot[j] = i;
+    }
 
-        // Fetch and decode instruction.
-        int instruction = getWord(&arm.memory[arm.pc]);
-        INSTRUCTION_TYPE type = getInstructionType(instruction);
+    char description[DESCRIPTION_SIZE];
+    printf("Hot spots in %s:\n", binary);
+    for (int j = 0; j < numHot; j++) {
+        uint64_t address = (uint64_t) hot[j] * INSTRUCTION_SIZE;
+        printf("%12lu  0x%08lx  %s\n", profile[hot[j]], address, describe(map, address, description));
+    }
+    memset(profile, 0, PROFILE_SIZE * sizeof(uint64_t));
+}
 
-        switch(type) {
-            case HALT:
-                goto halt; // Required to break out of both switch and for loop
-                break;
-            case DATA_PROCESSING_IMMEDIATE:
-                dataProcessingImmediate(&arm, instruction);
-                break;
-            case DATA_PROCESSING_REGISTER:
-                dataProcessingRegister(&arm, instruction);
+int main(int argc, char **argv) {
+    // Number of times each binary is run; the processor is reset in between.
+    long runs = 1;
+    symbol_map* map = NULL;
+    bool profiling = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:m:p")) != -1) {
+        switch (opt) {
+            case 'n':
+                runs = strtol(optarg, NULL, 10);
+                if (runs < 1) {
+                    usage();
+                }
                 break;
-            case SINGLE_DATA_TRANSFER:
-                singleDataTransfer(&arm, instruction);
+            case 'm':
+                map = loadSymbolMap(optarg);
                 break;
-            case BRANCH:
-                branch(&arm, instruction);
+            case 'p':
+                profiling = true;
                 break;
             default:
-                // Non-instruction data or NOP case; ignore.
-                break;
+                usage();
         }
+    }
+
+    // Check if binary file provided.
+    int numFiles = argc - optind;
+    if (numFiles < 1) {
+        fprintf(stderr, "emulate: no binary file provided.\n");
+        usage();
+    }
 
-        arm.pc += INSTRUCTION_SIZE;
+    // Several binaries must each be given an output file.
+    if (numFiles > 2 && numFiles % 2 != 0) {
+        usage();
     }
 
-    halt:
-        if (argc >= 3) {
-            outputState(&arm, argv[2]);
-        } else {
-            outputState(&arm, "output.out");
+    // A single ARM instance is reused for every run.
+    ARM* arm = newARM();
+    char* loops = getenv(LOOPS_ENV);
+    arm->interpretLoops = loops != NULL && strcmp(loops, "interpret") == 0;
+    if (profiling) {
+        arm->profile = calloc(PROFILE_SIZE, sizeof(uint64_t));
+        assert(arm->profile != NULL);
+    }
+    char description[DESCRIPTION_SIZE];
+
+    for (int i = optind; i < argc; i += 2) {
+        char* output = (i + 1 < argc) ? argv[i + 1] : DEFAULT_OUTPUT;
+
+        for (long run = 0; run < runs; run++) {
+            // Load instructions into memory.
+            loadBinary(arm, argv[i]);
+            RUN_STATUS status = runARM(arm, UINT64_MAX);
+            if (status == RUN_PC_OUT_OF_RANGE) {
+                fprintf(stderr, "the PC is: %lu which is out of range \n", arm->pc);
+                exit(EXIT_FAILURE);
+            } else if (status == RUN_FAULT && map != NULL) {
+                fprintf(stderr, "memory access out of range at PC: %lu (%s)\n", arm->pc,
+                        describe(map, arm->pc, description));
+                exit(EXIT_FAILURE);
+            } else if (status == RUN_FAULT) {
+                fprintf(stderr, "memory access out of range at PC: %lu\n", arm->pc);
+                exit(EXIT_FAILURE);
+            }
+            outputState(arm, output);
+            resetARM(arm);
+        }
+        if (profiling) {
+            printHotSpots(arm->profile, map, argv[i]);
         }
-        return EXIT_SUCCESS;
+    }
+
+    if (map != NULL) {
+        freeSymbolMap(map);
+    }
+    free(arm->profile);
+    free(arm);
+    return EXIT_SUCCESS;
 }
@@ -0,0 +1,176 @@
+// In-process fuzzing entry point for the emulator.
+//
+// Without a guest program the fuzz input is itself loaded as the binary, which fuzzes the emulator.
+// With a guest program (EMULATE_FUZZ_PROGRAM, or -p for the standalone driver) the input is copied to
+// FUZZ_INPUT_ADDRESS and passed to the guest with x0 = address and x1 = length.
+//
+// libFuzzer:  make fuzz CC=clang FUZZFLAGS="-fsanitize=fuzzer -DLIBFUZZER"
+// AFL:        make fuzz CC=afl-clang-fast   (persistent mode through __AFL_LOOP)
+// Standalone: ./fuzz_emulate [-p <program>] [<input>...]   (reads stdin if no inputs are given)
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include "defs.h"
+#include "arm.h"
+
+#define FUZZ_INPUT_ADDRESS (1 << 20)
+#define FUZZ_MAX_INPUT_SIZE (MAX_MEMORY_SIZE - FUZZ_INPUT_ADDRESS)
+#define FUZZ_INSTRUCTION_BUDGET 100000 // stops guests that never halt
+#define FUZZ_PROGRAM_ENV "EMULATE_FUZZ_PROGRAM"
+#define AFL_SHM_ENV "__AFL_SHM_ID"
+#define AFL_PERSISTENT_ITERATIONS 10000
+
+// Processor reused across iterations; reset between them.
+static ARM* arm;
+
+// Guest program, if the input is data rather than code.
+static uint8_t* program;
+static size_t programSize;
+
+// Edge coverage map. libFuzzer picks up counters in this section; AFL replaces it with its shared map.
+#ifdef LIBFUZZER
+__attribute__((section("__libfuzzer_extra_counters")))
+#endif
+static uint8_t localCoverage[COVERAGE_MAP_SIZE];
+
+// Reads a whole file into a heap buffer.
+static uint8_t* readWholeFile(const char* path, size_t* size) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "fuzz: cannot open %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    if (length < 0) {
+        fprintf(stderr, "fuzz: cannot read %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    fseek(file, 0, SEEK_SET);
+    uint8_t* buffer = malloc(length > 0 ? length : 1);
+    assert(buffer != NULL);
+    *size = fread(buffer, sizeof(uint8_t), length, file);
+    fclose(file);
+    return buffer;
+}
+
+// Sets up the processor and coverage map; program may be NULL.
+static void fuzzInit(const char* programPath) {
+    arm = newARM();
+    arm->coverage = localCoverage;
+
+    // AFL hands us a shared map to write coverage into.
+    char* shmId = getenv(AFL_SHM_ENV);
+    if (shmId != NULL) {
+        void* shared = shmat(atoi(shmId), NULL, 0);
+        if (shared != (void*) -1) {
+            arm->coverage = shared;
+        }
+    }
+
+    if (programPath != NULL) {
+        program = readWholeFile(programPath, &programSize);
+        if (programSize > FUZZ_INPUT_ADDRESS) {
+            programSize = FUZZ_INPUT_ADDRESS;
+        }
+    }
+}
+
+// Runs one fuzz input to completion, then resets state for the next one.
+static void fuzzOne(const uint8_t* data, size_t size) {
+    if (program != NULL) {
+        memcpy(arm->memory, program, programSize);
+        markDirty(arm, 0, programSize);
+
+        if (size > FUZZ_MAX_INPUT_SIZE) {
+            size = FUZZ_MAX_INPUT_SIZE;
+        }
+        memcpy(&arm->memory[FUZZ_INPUT_ADDRESS], data, size);
+        markDirty(arm, FUZZ_INPUT_ADDRESS, size);
+        arm->registers[0] = FUZZ_INPUT_ADDRESS;
+        arm->registers[1] = size;
+    } else {
+        if (size > MAX_MEMORY_SIZE) {
+            size = MAX_MEMORY_SIZE;
+        }
+        memcpy(arm->memory, data, size);
+        markDirty(arm, 0, size);
+    }
+
+    // Faults and exhausted budgets are normal guest outcomes, not emulator crashes.
+    runARM(arm, FUZZ_INSTRUCTION_BUDGET);
+    resetARM(arm);
+}
+
+#ifdef LIBFUZZER
+
+int LLVMFuzzerInitialize(int* argc, char*** argv) {
+    fuzzInit(getenv(FUZZ_PROGRAM_ENV));
+    return 0;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    fuzzOne(data, size);
+    return 0;
+}
+
+#else
+
+// Without afl-clang the persistent loop runs once.
+#ifndef __AFL_LOOP
+static int loopIterations;
+#define __AFL_LOOP(n) (loopIterations++ == 0)
+#endif
+
+// Reads all of standard input into buffer; returns number of bytes read.
+static size_t readInput(uint8_t* buffer, size_t max) {
+    size_t total = 0;
+    ssize_t got;
+    while (total < max && (got = read(STDIN_FILENO, buffer + total, max - total)) > 0) {
+        total += got;
+    }
+    return total;
+}
+
+int main(int argc, char** argv) {
+    char* programPath = getenv(FUZZ_PROGRAM_ENV);
+
+    int opt;
+    while ((opt = getopt(argc, argv, "p:")) != -1) {
+        if (opt == 'p') {
+            programPath = optarg;
+        } else {
+            fprintf(stderr, "fuzz: ./fuzz_emulate [-p <program>] [<input>...]\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    fuzzInit(programPath);
+
+    // Replay inputs given as files (e.g. crashes found earlier).
+    if (optind < argc) {
+        for (int i = optind; i < argc; i++) {
+            size_t size;
+            uint8_t* data = readWholeFile(argv[i], &size);
+            fuzzOne(data, size);
+            free(data);
+        }
+        return EXIT_SUCCESS;
+    }
+
+    uint8_t* buffer = malloc(MAX_MEMORY_SIZE);
+    assert(buffer != NULL);
+    while (__AFL_LOOP(AFL_PERSISTENT_ITERATIONS)) {
+        fuzzOne(buffer, readInput(buffer, MAX_MEMORY_SIZE));
+    }
+    free(buffer);
+    return EXIT_SUCCESS;
+}
+
+#endif
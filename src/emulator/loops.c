@@ -0,0 +1,210 @@
+#include <string.h>
+#include "defs.h"
+#include "utils.h"
+#include "arm.h"
+#include "loops.h"
+
+// A post-indexed single transfer that steps its base register forward by its own size.
+typedef struct {
+    int rt;
+    int xn;
+    int size;
+} step;
+
+// The shape of a recognised loop; load.size is 0 for a fill loop.
+typedef struct {
+    step load;
+    step store;
+    int counter;
+    uint64_t decrement;
+    bool sf;
+    int length; // in instructions
+} loop;
+
+/*
+Decoding
+*/
+
+// Decodes a load (or store) that the emulator would run as a post-indexed transfer of size bytes
+// with an offset of size.
+static bool decodeStep(uint32_t instruction, bool load, step* s) {
+    if (getInstructionType(instruction) != SINGLE_DATA_TRANSFER
+        || !ISA_GET(SDT_SINGLE, instruction)
+        || ISA_GET(SDT_L, instruction) != load
+        || ISA_GET(SDT_U, instruction)
+        || !ISA_GET(SDT_NOT_LITERAL, instruction)
+        || !ISA_GET(SDT_INDEXED, instruction)
+        || ISA_GET(SDT_I, instruction)) {
+        return false;
+    }
+    s->rt = ISA_GET(SDT_RT, instruction);
+    s->xn = ISA_GET(SDT_XN, instruction);
+    s->size = 1 << ISA_GET(SDT_SIZE, instruction);
+    return s->xn != ZR_INDEX && ISA_GET_SIGNED(SDT_SIMM9, instruction) == s->size;
+}
+
+// Decodes subs xn, xn, #k with a non-zero k.
+static bool decodeCounter(uint32_t instruction, loop* l) {
+    if (getInstructionType(instruction) != DATA_PROCESSING_IMMEDIATE
+        || ISA_GET(DPI_OPI, instruction) != ISA_DPI_ARITHMETIC_OPI
+        || ISA_GET(DP_OPC, instruction) != ISA_SUBS_OPC) {
+        return false;
+    }
+    l->counter = ISA_GET(DP_RD, instruction);
+    l->decrement = (uint64_t) ISA_GET(DPI_IMM12, instruction) << (ISA_GET(DPI_SH, instruction) ? 12 : 0);
+    l->sf = ISA_GET(DP_SF, instruction);
+    return l->counter == ISA_GET(DP_RN, instruction) && l->counter != ZR_INDEX && l->decrement != 0;
+}
+
+// Decodes b.ne back to the instruction length - 1 words before it.
+static bool decodeBranch(uint32_t instruction, int length) {
+    return getInstructionType(instruction) == BRANCH
+        && ISA_GET(BR_TYPE, instruction) == ISA_BR_TYPE_COND
+        && ISA_GET(BR_COND, instruction) == COND_NE
+        && ISA_GET_SIGNED(BR_SIMM19, instruction) == -(length - 1);
+}
+
+// Recognises a copy or fill loop starting at PC whose registers do not interfere with each other.
+static bool decodeLoop(ARM* arm, uint32_t instruction, loop* l) {
+    uint64_t pc = arm->pc;
+    memset(l, 0, sizeof(loop));
+
+    int next = 0;
+    if (decodeStep(instruction, true, &l->load)) {
+        // Loading into the zero register writes it, which a bulk copy would not reproduce.
+        if (l->load.rt == ZR_INDEX || pc > MAX_MEMORY_SIZE - 4 * INSTRUCTION_SIZE) {
+            return false;
+        }
+        l->length = 4;
+        next = INSTRUCTION_SIZE;
+        if (!decodeStep(getWord(&arm->memory[pc + next]), false, &l->store)
+            || l->store.rt != l->load.rt || l->store.size != l->load.size || l->store.xn == l->load.xn) {
+            return false;
+        }
+    } else if (decodeStep(instruction, false, &l->store)) {
+        if (pc > MAX_MEMORY_SIZE - 3 * INSTRUCTION_SIZE) {
+            return false;
+        }
+        l->length = 3;
+        // The failed decode as a load may have filled it in.
+        l->load.size = 0;
+    } else {
+        return false;
+    }
+
+    if (!decodeCounter(getWord(&arm->memory[pc + next + INSTRUCTION_SIZE]), l)
+        || !decodeBranch(getWord(&arm->memory[pc + next + 2 * INSTRUCTION_SIZE]), l->length)) {
+        return false;
+    }
+
+    // The value moved must not be a pointer or the counter, and the pointers must not be the counter.
+    int rt = l->store.rt;
+    if (rt == l->store.xn || rt == l->counter || l->store.xn == l->counter) {
+        return false;
+    }
+    if (l->load.size != 0 && (rt == l->load.xn || l->load.xn == l->counter)) {
+        return false;
+    }
+    return true;
+}
+
+/*
+Execution
+*/
+
+// Fills bytes of memory with the low size bytes of value repeated.
+static void fill(uint8_t* memory, uint64_t value, int size, uint64_t bytes) {
+    if (size == 1) {
+        memset(memory, value & BYTE_MASK, bytes);
+        return;
+    }
+    setBytes(memory, value, size);
+    // Double the filled prefix until it covers everything.
+    for (uint64_t filled = size; filled < bytes;) {
+        uint64_t chunk = filled < bytes - filled ? filled : bytes - filled;
+        memcpy(&memory[filled], memory, chunk);
+        filled += chunk;
+    }
+}
+
+// Number of size byte elements that fit in memory from address onwards.
+static uint64_t elementsInMemory(uint64_t address, int size) {
+    return address > MAX_MEMORY_SIZE ? 0 : (MAX_MEMORY_SIZE - address) / size;
+}
+
+// Runs all but the last iteration of a recognised copy or fill loop in bulk.
+uint64_t skipLoop(ARM* arm, uint32_t instruction, uint64_t budget) {
+    loop l;
+    if (!decodeLoop(arm, instruction, &l)) {
+        return 0;
+    }
+
+    // The loop exits when the counter reaches exactly zero; a counter that steps over zero
+    // (or starts there) wraps around, which is left to the interpreter.
+    uint64_t mask = l.sf ? UINT64_MAX : WREGISTER_MASK;
+    uint64_t sign = l.sf ? SUBS_64BIT_LMASK : SUBS_32BIT_LMASK;
+    uint64_t count = arm->registers[l.counter] & mask;
+    if (count == 0 || count % l.decrement != 0) {
+        return 0;
+    }
+
+    // Leave the last iteration, and at least one instruction of budget, to the interpreter.
+    uint64_t iterations = count / l.decrement - 1;
+    if (iterations > (budget - 1) / l.length) {
+        iterations = (budget - 1) / l.length;
+    }
+
+    // Stop short of any access that would fault, so that the interpreter faults on it.
+    int size = l.store.size;
+    uint64_t destination = arm->registers[l.store.xn];
+    uint64_t source = l.load.size != 0 ? arm->registers[l.load.xn] : 0;
+    if (iterations > elementsInMemory(destination, size)) {
+        iterations = elementsInMemory(destination, size);
+    }
+    if (l.load.size != 0 && iterations > elementsInMemory(source, size)) {
+        iterations = elementsInMemory(source, size);
+    }
+    if (iterations == 0) {
+        return 0;
+    }
+    uint64_t bytes = iterations * size;
+
+    // Stores into the loop itself change what runs next.
+    uint64_t start = arm->pc;
+    uint64_t end = start + l.length * INSTRUCTION_SIZE;
+    if (destination < end && start < destination + bytes) {
+        return 0;
+    }
+
+    if (l.load.size != 0) {
+        // A destination just above the source copies the first elements over and over, unlike memmove.
+        if (destination > source && destination < source + bytes) {
+            return 0;
+        }
+        // Each element is loaded before anything overwrites it, so the last one loaded is as in memory now.
+        arm->registers[l.load.rt] = getBytes(&arm->memory[source + bytes - size], size);
+        memmove(&arm->memory[destination], &arm->memory[source], bytes);
+        arm->registers[l.load.xn] += bytes;
+    } else {
+        fill(&arm->memory[destination], arm->registers[l.store.rt], size, bytes);
+    }
+    markDirty(arm, destination, bytes);
+    arm->registers[l.store.xn] += bytes;
+
+    // Flags are those of the last subs run, which took the counter from before to after.
+    uint64_t before = (count - l.decrement * (iterations - 1)) & mask;
+    uint64_t after = (before - l.decrement) & mask;
+    arm->registers[l.counter] = after;
+    arm->pstate = PSTATE_NZCV((after & sign) != 0, after == 0, before >= l.decrement,
+        ((before ^ l.decrement) & (before ^ after) & sign) != 0);
+
+    if (arm->profile != NULL) {
+        for (int i = 0; i < l.length; i++) {
+            arm->profile[start / INSTRUCTION_SIZE + i] += iterations;
+        }
+    }
+    if (arm->coverage != NULL) {
+        recordEdgeHits(arm, end - INSTRUCTION_SIZE, start, iterations);
+    }
+    return iterations * l.length;
+}
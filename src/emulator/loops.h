@@ -0,0 +1,8 @@
+#include "defs.h"
+
+// If the instruction at PC starts a copy loop (ldr, str, subs, b.ne) or a fill loop (str, subs, b.ne)
+// stepping through memory with post-indexed transfers, runs all but its last iteration as one host
+// memmove or memset, leaving registers, flags, memory, profile and coverage as if they had been
+// interpreted; PC is left at the start of the loop. At most budget - 1 instructions are skipped and the
+// number skipped is returned, 0 if the loop was not recognised or its preconditions do not hold.
+uint64_t skipLoop(ARM* arm, uint32_t instruction, uint64_t budget);
@@ -0,0 +1,117 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include "defs.h"
+#include "symbol_map.h"
+
+#define INITIAL_MAP_CAPACITY 64
+
+// Appends an entry of the given size to a growable array.
+static void* append(void* array, uint32_t* size, uint32_t* capacity, size_t entrySize) {
+    if (*size == *capacity) {
+        *capacity = *capacity == 0 ? INITIAL_MAP_CAPACITY : *capacity * 2;
+        array = realloc(array, *capacity * entrySize);
+        assert(array != NULL);
+    }
+    (*size)++;
+    return array;
+}
+
+// Reads the symbol map at path; exits if it cannot be read.
+symbol_map* loadSymbolMap(char* path) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "emulate: cannot open symbol map %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+
+    symbol_map* map = calloc(1, sizeof(symbol_map));
+    assert(map != NULL);
+    uint32_t labelCapacity = 0;
+    uint32_t runCapacity = 0;
+
+    char* line = NULL;
+    size_t lineCapacity = 0;
+    while (getline(&line, &lineCapacity, file) != -1) {
+        char* end;
+        uint32_t address = strtoul(line, &end, 16);
+        uint32_t number = strtoul(end, &end, 10);
+        end += strspn(end, " ");
+        end[strcspn(end, "\r\n")] = '\0';
+
+        // Entries with a name are labels; the others start runs of lines. "*" marks a run of one line.
+        bool single = strcmp(end, "*") == 0;
+        if (*end != '\0' && !single) {
+            map->labels = append(map->labels, &map->numLabels, &labelCapacity, sizeof(map_label));
+            map_label* label = &map->labels[map->numLabels - 1];
+            label->address = address;
+            label->line = number;
+            label->name = strdup(end);
+            assert(label->name != NULL);
+        } else {
+            map->runs = append(map->runs, &map->numRuns, &runCapacity, sizeof(map_run));
+            map->runs[map->numRuns - 1].address = address;
+            map->runs[map->numRuns - 1].line = number;
+            map->runs[map->numRuns - 1].single = single;
+        }
+    }
+    free(line);
+    fclose(file);
+    return map;
+}
+
+// Frees the map and its labels.
+void freeSymbolMap(symbol_map* map) {
+    for (uint32_t i = 0; i < map->numLabels; i++) {
+        free(map->labels[i].name);
+    }
+    free(map->labels);
+    free(map->runs);
+    free(map);
+}
+
+// Returns the index of the last of n entries (each size bytes, the first field an address)
+// at or below address, or -1 if there is none.
+static int64_t lastAtOrBelow(void* entries, uint32_t n, size_t size, uint64_t address) {
+    int64_t low = 0;
+    int64_t high = (int64_t) n - 1;
+    int64_t found = -1;
+    while (low <= high) {
+        int64_t middle = (low + high) / 2;
+        uint32_t entry = *(uint32_t*) ((char*) entries + middle * size);
+        if (entry <= address) {
+            found = middle;
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return found;
+}
+
+// Writes address as "label+0xoffset (line n)" into buffer, leaving out what the map cannot tell.
+void symbolize(symbol_map* map, uint64_t address, char* buffer, size_t size) {
+    int64_t label = lastAtOrBelow(map->labels, map->numLabels, sizeof(map_label), address);
+    int64_t run = lastAtOrBelow(map->runs, map->numRuns, sizeof(map_run), address);
+
+    // Several labels may share an address; the first of them names it.
+    while (label > 0 && map->labels[label - 1].address == map->labels[label].address) {
+        label--;
+    }
+
+    int written = 0;
+    if (label >= 0) {
+        map_label* l = &map->labels[label];
+        written = snprintf(buffer, size, "%s+0x%lx", l->name, (unsigned long) (address - l->address));
+    } else {
+        written = snprintf(buffer, size, "0x%lx", (unsigned long) address);
+    }
+    // Line 0 marks words with no source line, such as the literal pool.
+    if (run >= 0 && map->runs[run].line != 0 && written >= 0 && (size_t) written < size) {
+        map_run* r = &map->runs[run];
+        snprintf(buffer + written, size - written, " (line %lu)",
+                 (unsigned long) (r->single ? r->line : r->line + (address - r->address) / INSTRUCTION_SIZE));
+    }
+}
@@ -0,0 +1,35 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Label from a symbol map written by assemble -m.
+typedef struct {
+    uint32_t address;
+    uint32_t line;
+    char* name;
+} map_label;
+
+// Instructions from address on come from consecutive source lines, starting with line,
+// or with single, all words from address on come from line.
+typedef struct {
+    uint32_t address;
+    uint32_t line;
+    bool single;
+} map_run;
+
+// Symbol map, sorted by address.
+typedef struct {
+    map_label* labels;
+    uint32_t numLabels;
+    map_run* runs;
+    uint32_t numRuns;
+} symbol_map;
+
+// Reads the symbol map at path; exits if it cannot be read.
+symbol_map* loadSymbolMap(char* path);
+
+// Frees the map and its labels.
+void freeSymbolMap(symbol_map* map);
+
+// Writes address as "label+0xoffset (line n)" into buffer, leaving out what the map cannot tell.
+void symbolize(symbol_map* map, uint64_t address, char* buffer, size_t size);
@@ -1,9 +1,11 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include <math.h>
 #include <inttypes.h>
 #include "defs.h"
+#include "arm.h"
 
 // Returns word from byte addressable memory
 uint32_t getWord(uint8_t* memory) {
@@ -20,10 +22,24 @@ uint64_t getDoubleWord(uint8_t* memory) {
     return (uint64_t) getWord(memory) + ((uint64_t)getWord(memory + BYTES_IN_WORD) << 32);
 }
 
-// Outputs state of ARM processor into .out file.
-void outputState(ARM *arm, char *file) {
-    FILE* output = fopen(file, "w");
+// Returns n little endian bytes from byte addressable memory
+uint64_t getBytes(uint8_t* memory, int n) {
+    uint64_t value = 0;
+    for (int i = 0; i < n; i++) {
+        value |= ((uint64_t) memory[i]) << (SIZE_OF_BYTE * i);
+    }
+    return value;
+}
 
+// Stores the low n bytes of value into byte addressable memory in little endian order
+void setBytes(uint8_t* memory, uint64_t value, int n) {
+    for (int i = 0; i < n; i++) {
+        memory[i] = (value >> (SIZE_OF_BYTE * i)) & BYTE_MASK;
+    }
+}
+
+// Writes the state of the ARM processor in .out format to an open stream.
+void writeState(ARM* arm, FILE* output) {
     // Output registers.
     fprintf(output, "Registers: \n");
 
@@ -36,26 +52,47 @@ void outputState(ARM *arm, char *file) {
 
     // Output PSTATE
     fprintf(output, "PSTATE: ");
-    fprintf(output, (arm->pstate.N) ? "N" : "-");
-    fprintf(output, (arm->pstate.Z) ? "Z" : "-");
-    fprintf(output, (arm->pstate.C) ? "C" : "-");
-    fprintf(output, (arm->pstate.V) ? "V\n" : "-\n");
+    fprintf(output, (arm->pstate & ISA_FLAG_N) ? "N" : "-");
+    fprintf(output, (arm->pstate & ISA_FLAG_Z) ? "Z" : "-");
+    fprintf(output, (arm->pstate & ISA_FLAG_C) ? "C" : "-");
+    fprintf(output, (arm->pstate & ISA_FLAG_V) ? "V\n" : "-\n");
 
     // Output Memory
     fprintf(output, "Non-zero memory:\n");
 
-    for (int i = 0; i < MAX_MEMORY_SIZE; i += 4) {
-		if (getWord(&arm->memory[i]) != 0) {
-            // Bytes are stored in little endian so have to convert.
-            fprintf(output, "0x%08x: %08x\n", i, getWord(&arm->memory[i]));
-		}
-	}
+    // Pages that were never written since the last reset are still all zero.
+    for (int page = 0; page < NUM_OF_PAGES; page++) {
+        if (!(arm->dirtyPages[page / PAGES_PER_DIRTY_WORD] >> (page % PAGES_PER_DIRTY_WORD) & 1)) {
+            continue;
+        }
+        for (int i = page * MEMORY_PAGE_SIZE; i < (page + 1) * MEMORY_PAGE_SIZE; i += 4) {
+            if (getWord(&arm->memory[i]) != 0) {
+                // Bytes are stored in little endian so have to convert.
+                fprintf(output, "0x%08x: %08x\n", i, getWord(&arm->memory[i]));
+            }
+        }
+    }
+}
+
+// Outputs state of ARM processor into .out file.
+void outputState(ARM *arm, char *file) {
+    FILE* output = fopen(file, "w");
+    writeState(arm, output);
+    fclose(output);
+}
 
+// Returns the state of the ARM processor in .out format as a string, which the caller frees.
+char* stateString(ARM* arm, size_t* length) {
+    char* state;
+    FILE* output = open_memstream(&state, length);
+    assert(output != NULL);
+    writeState(arm, output);
     fclose(output);
+    return state;
 }
 
-// Given a array of memory and a binary file, data from file will be loaded into array.
-void loadBinary(uint8_t* memory, char* path) {
+// Given an ARM processor and a binary file, data from file will be loaded into its memory.
+void loadBinary(ARM* arm, char* path) {
 
     FILE* binary = fopen(path, "rb");
 
@@ -65,19 +102,20 @@ void loadBinary(uint8_t* memory, char* path) {
         exit(EXIT_FAILURE);
     }
 
-    // Read data from binary until end of file. Only 1 piece of data read each time.
-    int i = 0, read = 1;
-    while (read) {
-        read = fread(&memory[i], sizeof(uint8_t), 1, binary);
-        i++;
-    }
+    // Read data from binary until end of file or memory is full.
+    size_t read = fread(arm->memory, sizeof(uint8_t), MAX_MEMORY_SIZE, binary);
+    markDirty(arm, 0, read);
 
     fclose(binary);
-    // assert(getWord(&memory[0]) == 0xd28001e1);
-    printf("%02x", memory[1]);
+}
 
-    //assert(*memory == 0xe1);
-    //assert(memory[1] == 0x01);
+// Copies size bytes of program into the start of memory, stopping when memory is full.
+void loadProgram(ARM* arm, const uint8_t* program, size_t size) {
+    if (size > MAX_MEMORY_SIZE) {
+        size = MAX_MEMORY_SIZE;
+    }
+    memcpy(arm->memory, program, size);
+    markDirty(arm, 0, size);
 }
 
 /*
@@ -96,9 +134,14 @@ static uint64_t wregisterMask(uint64_t value, bool is64bit) {
 uint64_t ror(uint64_t value, uint32_t shift, bool is64bit) {
     assert(shift >= 0);
     int bits = is64bit ? 64 : 32;
-    // If 32 bit, mask top 32 bits after shift.
+    // Rotating by the width (or 0) leaves value unchanged; avoids shifting by the full width.
+    shift %= bits;
     value = wregisterMask(value, is64bit);
-    return (value >> shift) | (value << (bits - shift));
+    if (shift == 0) {
+        return value;
+    }
+    // If 32 bit, mask top 32 bits after shift.
+    return wregisterMask((value >> shift) | (value << (bits - shift)), is64bit);
 }
 
 // Logical shift left
@@ -158,9 +201,7 @@ static uint64_t bitClear(uint64_t n, int k, int l) {
 
 // Sets l bits starting from kth position of n to new.
 uint64_t setBitsTo(uint64_t n, int k, uint64_t new, int l) {
-    printf("%.32lx\n", n);
     uint64_t cleared = bitClear(n, k, l);
-    printf("%.32lx\n", cleared);
     return cleared | new << (k - l);
 }
 
@@ -171,24 +212,21 @@ uint64_t extendBits(uint64_t n, int l) {
     return (n ^ m) - m;
 }
 
+// Instruction class of every op0 value, generated from the ISA description.
+static const INSTRUCTION_TYPE classOfOp0[1 << OP0_LEN] = {
+    ISA_DECODE_CLASS(0x0, DATA), ISA_DECODE_CLASS(0x1, DATA), ISA_DECODE_CLASS(0x2, DATA), ISA_DECODE_CLASS(0x3, DATA),
+    ISA_DECODE_CLASS(0x4, DATA), ISA_DECODE_CLASS(0x5, DATA), ISA_DECODE_CLASS(0x6, DATA), ISA_DECODE_CLASS(0x7, DATA),
+    ISA_DECODE_CLASS(0x8, DATA), ISA_DECODE_CLASS(0x9, DATA), ISA_DECODE_CLASS(0xa, DATA), ISA_DECODE_CLASS(0xb, DATA),
+    ISA_DECODE_CLASS(0xc, DATA), ISA_DECODE_CLASS(0xd, DATA), ISA_DECODE_CLASS(0xe, DATA), ISA_DECODE_CLASS(0xf, DATA)
+};
+
 // Gets instruction type given instruction.
 INSTRUCTION_TYPE getInstructionType(uint32_t instruction) {
-    uint32_t op0 = getBitsAt(instruction, OP0_START, OP0_LEN);
-
-    if (instruction == HALT_CODE) {
+    if (instruction == ISA_HALT_CODE) {
         return HALT;
-    } else if (instruction == NOP_CODE) {
+    } else if (instruction == ISA_NOP_CODE) {
         return NOP;
-    } else if ((op0 & 0xe) == 0x8) {
-        return DATA_PROCESSING_IMMEDIATE;
-    } else if ((op0 & 0x7) == 0x5) {
-        return DATA_PROCESSING_REGISTER;
-    } else if ((op0 & 0x5) == 0x4) {
-        return SINGLE_DATA_TRANSFER;
-    } else if ((op0 & 0xe) == 0xa) {
-        return BRANCH;
-    } else {
-        // Default case; not instruction.
-        return DATA;
     }
+    // Default case of the table is DATA; not instruction.
+    return classOfOp0[ISA_GET(OP0, instruction)];
 }
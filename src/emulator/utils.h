@@ -1,13 +1,24 @@
+#include <stdio.h>
+#include <stddef.h>
 #include "defs.h"
 
 // Gets instruction type given instruction.
 INSTRUCTION_TYPE getInstructionType(uint32_t instruction);
 
+// Writes the state of the ARM processor in .out format to an open stream.
+void writeState(ARM* arm, FILE* output);
+
 // Outputs state of ARM processor into .out file.
 void outputState(ARM* arm, char *file);
 
-// Given a array of memory and a binary file, data from file will be loaded into array.
-void loadBinary(uint8_t* memory, char* path);
+// Returns the state of the ARM processor in .out format as a string, which the caller frees.
+char* stateString(ARM* arm, size_t* length);
+
+// Given an ARM processor and a binary file, data from file will be loaded into its memory.
+void loadBinary(ARM* arm, char* path);
+
+// Copies size bytes of program into the start of memory, stopping when memory is full.
+void loadProgram(ARM* arm, const uint8_t* program, size_t size);
 
 // Returns word from byte addressable memory
 uint32_t getWord(uint8_t* memory);
@@ -15,6 +26,12 @@ uint32_t getWord(uint8_t* memory);
 // Returns double word from byte addressable memory
 uint64_t getDoubleWord(uint8_t* memory);
 
+// Returns n little endian bytes from byte addressable memory
+uint64_t getBytes(uint8_t* memory, int n);
+
+// Stores the low n bytes of value into byte addressable memory in little endian order
+void setBytes(uint8_t* memory, uint64_t value, int n);
+
 // Rotate right
 uint64_t ror(uint64_t value, uint32_t shift, bool is64bit);
 
@@ -0,0 +1,217 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include "isa.h"
+#include "object.h"
+#include "binary_file.h"
+
+#define INSTRUCTION_SIZE 4 // in bytes
+#define MODULE_ALIGNMENT 8 // bytes; literal pool entries are aligned to this within their object
+
+// Object file loaded into memory, with its parts located.
+typedef struct {
+    char* path;
+    uint8_t* data;
+    object_header header;
+    uint32_t* words;
+    object_symbol* symbols;
+    object_relocation* relocations;
+    char* strings;
+    uint32_t base; // address the object is placed at
+} module;
+
+// Label defined by one of the modules, at its final address.
+typedef struct {
+    char* name;
+    uint32_t address;
+} global_symbol;
+
+// Reads a whole file into a heap buffer.
+static uint8_t* readWholeFile(char* path, size_t* size) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "link: cannot open %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t* buffer = malloc(length > 0 ? length : 1);
+    assert(buffer != NULL);
+    *size = fread(buffer, sizeof(uint8_t), length, file);
+    fclose(file);
+    return buffer;
+}
+
+// Exits after reporting a malformed object.
+static void badObject(char* path) {
+    fprintf(stderr, "link: %s is not an object written by assemble -c\n", path);
+    exit(EXIT_FAILURE);
+}
+
+// Loads the object at path and checks that its parts fit in the file.
+static void loadModule(module* m, char* path) {
+    size_t size;
+    m->path = path;
+    m->data = readWholeFile(path, &size);
+    if (size < sizeof(object_header)) {
+        badObject(path);
+    }
+    memcpy(&m->header, m->data, sizeof(object_header));
+    object_header* h = &m->header;
+    if (h->magic != OBJECT_MAGIC || h->version != OBJECT_VERSION) {
+        badObject(path);
+    }
+
+    uint64_t expected = sizeof(object_header) + (uint64_t) h->numWords * sizeof(uint32_t)
+        + (uint64_t) h->numSymbols * sizeof(object_symbol)
+        + (uint64_t) h->numRelocations * sizeof(object_relocation) + h->stringsSize;
+    if (expected != size || (h->stringsSize > 0 && m->data[size - 1] != '\0')) {
+        badObject(path);
+    }
+
+    m->words = (uint32_t*) (m->data + sizeof(object_header));
+    m->symbols = (object_symbol*) (m->words + h->numWords);
+    m->relocations = (object_relocation*) (m->symbols + h->numSymbols);
+    m->strings = (char*) (m->relocations + h->numRelocations);
+
+    for (uint32_t i = 0; i < h->numSymbols; i++) {
+        if (m->symbols[i].name >= h->stringsSize) {
+            badObject(path);
+        }
+    }
+    for (uint32_t i = 0; i < h->numRelocations; i++) {
+        object_relocation* r = &m->relocations[i];
+        if (r->address % INSTRUCTION_SIZE != 0 || r->address / INSTRUCTION_SIZE >= h->numWords
+            || r->symbol >= h->numSymbols
+            || r->len == 0 || r->start + r->len > 32) {
+            badObject(path);
+        }
+    }
+}
+
+static int compareSymbols(const void* a, const void* b) {
+    return strcmp(((global_symbol*) a)->name, ((global_symbol*) b)->name);
+}
+
+// Returns the defined symbol called name, or NULL.
+static global_symbol* findSymbol(global_symbol* symbols, uint32_t n, char* name) {
+    global_symbol key = {name, 0};
+    return bsearch(&key, symbols, n, sizeof(global_symbol), compareSymbols);
+}
+
+// Links relocatable objects into a flat binary. Objects are placed one after another in the order
+// given, each at a MODULE_ALIGNMENT boundary, so the first one starts at address 0, where the
+// emulator begins executing.
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "link: ./link <object>... <file_out>\n");
+        exit(EXIT_FAILURE);
+    }
+    int numModules = argc - 2;
+    char* outPath = argv[argc - 1];
+
+    module* modules = malloc(numModules * sizeof(module));
+    assert(modules != NULL);
+    uint64_t numWords = 0;
+    uint64_t numSymbols = 0;
+    for (int i = 0; i < numModules; i++) {
+        loadModule(&modules[i], argv[i + 1]);
+        // Pool entries are aligned within the object, so the object must start aligned too.
+        if (numWords * INSTRUCTION_SIZE % MODULE_ALIGNMENT != 0) {
+            numWords++;
+        }
+        modules[i].base = numWords * INSTRUCTION_SIZE;
+        numWords += modules[i].header.numWords;
+        numSymbols += modules[i].header.numSymbols;
+        if (numWords * INSTRUCTION_SIZE > UINT32_MAX) {
+            fprintf(stderr, "link: program does not fit in the address space\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Every label some module refers to without defining it, sorted by name.
+    uint64_t numRelocations = 0;
+    for (int i = 0; i < numModules; i++) {
+        numRelocations += modules[i].header.numRelocations;
+    }
+    global_symbol* referenced = malloc((numRelocations > 0 ? numRelocations : 1) * sizeof(global_symbol));
+    assert(referenced != NULL);
+    uint32_t numReferenced = 0;
+    for (int i = 0; i < numModules; i++) {
+        module* m = &modules[i];
+        for (uint32_t r = 0; r < m->header.numRelocations; r++) {
+            referenced[numReferenced].name = m->strings + m->symbols[m->relocations[r].symbol].name;
+            referenced[numReferenced].address = 0;
+            numReferenced++;
+        }
+    }
+    qsort(referenced, numReferenced, sizeof(global_symbol), compareSymbols);
+
+    // The labels other modules refer to, sorted by name so references can be found by binary search.
+    // A module's references to its own labels are already encoded, so the rest stay local to it and
+    // several modules may use the same name.
+    global_symbol* symbols = malloc((numSymbols > 0 ? numSymbols : 1) * sizeof(global_symbol));
+    assert(symbols != NULL);
+    uint32_t numDefined = 0;
+    for (int i = 0; i < numModules; i++) {
+        module* m = &modules[i];
+        for (uint32_t s = 0; s < m->header.numSymbols; s++) {
+            if (m->symbols[s].defined && findSymbol(referenced, numReferenced, m->strings + m->symbols[s].name) != NULL) {
+                symbols[numDefined].name = m->strings + m->symbols[s].name;
+                symbols[numDefined].address = m->base + m->symbols[s].address;
+                numDefined++;
+            }
+        }
+    }
+    qsort(symbols, numDefined, sizeof(global_symbol), compareSymbols);
+    for (uint32_t s = 1; s < numDefined; s++) {
+        if (strcmp(symbols[s - 1].name, symbols[s].name) == 0) {
+            fprintf(stderr, "Label (%s) defined more than once.\n", symbols[s].name);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Lay the modules out and fill in their references to each other.
+    uint32_t* binary = malloc((numWords > 0 ? numWords : 1) * sizeof(uint32_t));
+    assert(binary != NULL);
+    // Padding between modules is nops, so code that runs off the end of one still reaches the next.
+    for (uint64_t w = 0; w < numWords; w++) {
+        binary[w] = ISA_NOP_CODE;
+    }
+    for (int i = 0; i < numModules; i++) {
+        module* m = &modules[i];
+        memcpy(binary + m->base / INSTRUCTION_SIZE, m->words, (size_t) m->header.numWords * sizeof(uint32_t));
+
+        for (uint32_t r = 0; r < m->header.numRelocations; r++) {
+            object_relocation* reloc = &m->relocations[r];
+            char* name = m->strings + m->symbols[reloc->symbol].name;
+            global_symbol* target = findSymbol(symbols, numDefined, name);
+            if (target == NULL) {
+                fprintf(stderr, "Label (%s) not in symbol table.\n", name);
+                exit(EXIT_FAILURE);
+            }
+            uint32_t address = m->base + reloc->address;
+            binary[address / INSTRUCTION_SIZE] |=
+                ISA_PUT_AT(reloc->start, reloc->len, (target->address - address) / INSTRUCTION_SIZE);
+        }
+    }
+
+    // Like assemble's, the binary appears whole or not at all.
+    if (!replaceFile(outPath, binary, numWords * sizeof(uint32_t))) {
+        fprintf(stderr, "Error writing file at %s\n", outPath);
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < numModules; i++) {
+        free(modules[i].data);
+    }
+    free(modules);
+    free(referenced);
+    free(symbols);
+    free(binary);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,46 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include "../assembler/assembler.h"
+#include "../emulator/defs.h"
+#include "../emulator/arm.h"
+#include "../emulator/utils.h"
+#include "pipeline.h"
+
+// Returns the time since an arbitrary fixed point, in seconds.
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+// Assembles the file at path into memory, loads it straight into arm and runs it to completion,
+// without writing a binary to disk. Stage timings are recorded in times unless it is NULL.
+run_result assembleAndRun(ARM* arm, char* path, int numThreads, stage_times* times) {
+    run_result result;
+    double start = now();
+
+    uint32_t size;
+    uint32_t* words = assembleFile(path, numThreads, false, NULL, &size);
+    double assembled = now();
+
+    // Words are in host order, which is the little endian layout of the emulator's memory.
+    loadProgram(arm, (uint8_t*) words, (size_t) size * sizeof(uint32_t));
+    free(words);
+    double loaded = now();
+
+    result.status = runARM(arm, UINT64_MAX);
+    double ran = now();
+
+    result.state = stateString(arm, &result.length);
+    double finished = now();
+
+    if (times != NULL) {
+        times->assemble = assembled - start;
+        times->load = loaded - assembled;
+        times->run = ran - loaded;
+        times->output = finished - ran;
+    }
+    return result;
+}
@@ -0,0 +1,22 @@
+#include <stdint.h>
+#include <stddef.h>
+#include "../emulator/defs.h"
+
+// Seconds spent in each stage of assembleAndRun.
+typedef struct {
+    double assemble;
+    double load;
+    double run;
+    double output;
+} stage_times;
+
+// Outcome of a program run by assembleAndRun.
+typedef struct {
+    RUN_STATUS status;
+    char* state;   // final state in .out format; freed by the caller
+    size_t length;
+} run_result;
+
+// Assembles the file at path into memory, loads it straight into arm and runs it to completion,
+// without writing a binary to disk. Stage timings are recorded in times unless it is NULL.
+run_result assembleAndRun(ARM* arm, char* path, int numThreads, stage_times* times);
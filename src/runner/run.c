@@ -0,0 +1,70 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "../emulator/defs.h"
+#include "../emulator/arm.h"
+#include "pipeline.h"
+
+static void usage(void) {
+    fprintf(stderr, "run: ./run [-j <threads>] [-t] <file_in> [<file_out>]\n");
+    exit(EXIT_FAILURE);
+}
+
+// Assembles and emulates a program in one process. The final state goes to file_out,
+// or to standard output if none is given.
+int main(int argc, char **argv) {
+    int numThreads = 0;
+    bool timing = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "j:t")) != -1) {
+        switch (opt) {
+            case 'j':
+                numThreads = atoi(optarg);
+                if (numThreads < 1) {
+                    usage();
+                }
+                break;
+            case 't':
+                timing = true;
+                break;
+            default:
+                usage();
+        }
+    }
+    if (argc - optind < 1 || argc - optind > 2) {
+        usage();
+    }
+
+    ARM* arm = newARM();
+    stage_times times;
+    run_result result = assembleAndRun(arm, argv[optind], numThreads, &times);
+
+    if (result.status == RUN_PC_OUT_OF_RANGE) {
+        fprintf(stderr, "the PC is: %lu which is out of range \n", arm->pc);
+        exit(EXIT_FAILURE);
+    } else if (result.status == RUN_FAULT) {
+        fprintf(stderr, "memory access out of range at PC: %lu\n", arm->pc);
+        exit(EXIT_FAILURE);
+    }
+
+    FILE* output = argc - optind == 2 ? fopen(argv[optind + 1], "w") : stdout;
+    if (output == NULL) {
+        fprintf(stderr, "run: cannot open %s\n", argv[optind + 1]);
+        exit(EXIT_FAILURE);
+    }
+    fwrite(result.state, 1, result.length, output);
+    if (output != stdout) {
+        fclose(output);
+    }
+
+    if (timing) {
+        fprintf(stderr, "assemble %.6fs  load %.6fs  run %.6fs  output %.6fs\n",
+                times.assemble, times.load, times.run, times.output);
+    }
+
+    free(result.state);
+    free(arm);
+    return EXIT_SUCCESS;
+}